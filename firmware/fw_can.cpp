@@ -8,49 +8,98 @@
  * of the included license.  See the LICENSE file for details.
  */
 
-#include "gleos/uart.h"
+#include "gleos/layer3.h"
+#include "gleos/shell.h"
+#include "gleos/spi.h"
 
-#include "pico/time.h"
-
-#include "hardware/spi.h"
-#include "hardware/gpio.h"
+#include "driver/mcp2515.h"
 
 #include <iostream>
-#include <sstream>
+
+#define UART_ID uart1
+#define UART_TX_PIN 4
+#define UART_RX_PIN 5
+
+#define ICE_DEVICE_ADDR 0xb
+#define FIRMWARE_VERSION_MAJOR 2
+#define FIRMWARE_VERSION_MINOR 3
 
 int main()
 {
+    // Enable logger console.
     gleos::stdio_console_port();
 
-    spi_init(spi_default, 10000000); // 10MHz
-    gpio_set_function(PICO_DEFAULT_SPI_RX_PIN, GPIO_FUNC_SPI);
-    gpio_set_function(PICO_DEFAULT_SPI_SCK_PIN, GPIO_FUNC_SPI);
-    gpio_set_function(PICO_DEFAULT_SPI_TX_PIN, GPIO_FUNC_SPI);
+    // Open the CAN controller at 10MHz SPI.
+    gleos::spi::block spi_0{
+        spi_default,
+        PICO_DEFAULT_SPI_TX_PIN,
+        PICO_DEFAULT_SPI_RX_PIN,
+        PICO_DEFAULT_SPI_SCK_PIN,
+        PICO_DEFAULT_SPI_CSN_PIN,
+        10,
+    };
 
-    gpio_init(PICO_DEFAULT_SPI_CSN_PIN);
-    gpio_set_dir(PICO_DEFAULT_SPI_CSN_PIN, GPIO_OUT);
-    gpio_put(PICO_DEFAULT_SPI_CSN_PIN, 1);
+    mcp2515 controller{spi_0};
 
-    while (true)
+    // Open the data channel.
+    gleos::ice::can_transport link{controller};
+    gleos::ice::layer3 netlayer{link, ICE_DEVICE_ADDR, {FIRMWARE_VERSION_MAJOR, FIRMWARE_VERSION_MINOR}};
+
+    const auto periodic_update = [&]
     {
-        absolute_time_t boot_time = get_absolute_time();
-        auto ten_sec = to_ms_since_boot(boot_time) / 100;
+        // Announce this device on the network.
+        netlayer.announce_device();
+
+        std::cout << "Announce device on network" << std::endl;
+        std::cout << "Uptime since boot: " << gleos::sec_since_boot() << " seconds" << std::endl;
+
+        return true;
+    };
+
+    // The announcement shares the SPI bus with the network, so it
+    // runs from the main loop instead of the timer interrupt.
+    gleos::timer_interval timer{gleos::ice::broadcast_service::default_interval, periodic_update, "announce", gleos::timer_interval::mode::deferred};
+
+    // Accounts the main loop, except for the time spent waiting on the network. The
+    // load is not broadcast since it does not fit a CAN frame, use `top` instead.
+    gleos::load::task main_task{"can.main"};
 
+    // The shell is polled from the main loop, next to the network.
+    gleos::uart serial{UART_ID, UART_TX_PIN, UART_RX_PIN};
+    gleos::shell console{serial};
+
+    gleos::shell::command address_command{
+        "address",
+        "",
+        "Show the network address",
+        [](const gleos::shell::arguments &, gleos::shell::writer &out, void *context)
         {
-            std::stringstream ss;
+            const auto &filter = static_cast<gleos::ice::layer3 *>(context)->filter();
 
-            ss << "[UART0] ["
-               << ten_sec
-               << "] "
-               << "Hello, world!, I am device: "
-               << gleos::unique_id()
-               << "\n"
-               << std::flush;
+            out << "Address: " << filter.address() << "\r\n";
+            for (size_t i = 0; i < filter.group_count(); ++i)
+            {
+                out << "Group: " << filter.groups()[i] << "\r\n";
+            }
+        },
+        &netlayer,
+    };
 
-            std::cout << ss.str();
-        }
+    // The controller is polled, there is no interrupt to sleep on.
+    while (true)
+    {
+        gleos::timer_interval::run_deferred();
 
-        gleos::sleep(500);
+        console.poll();
+
+        while (auto frame = netlayer.try_accept())
+        {
+            gleos::load::scope scope{main_task};
+
+            std::cout << "Received frame" << '\n'
+                      << " Address: " << frame->address() << '\n'
+                      << " Payload: " << static_cast<int>(frame->payload_type()) << std::endl;
+        }
     }
 
     return 0;
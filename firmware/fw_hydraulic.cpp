@@ -15,6 +15,8 @@
 #include "gleos/watchdog.h"
 #include "gleos/layer3.h"
 #include "gleos/interval.h"
+#include "gleos/timesync.h"
+#include "gleos/link.h"
 
 #include <iostream>
 
@@ -22,6 +24,9 @@
 #define UART_TX_PIN 4
 #define UART_RX_PIN 5
 
+// Validity of a control value when the host does not set one.
+#define CONTROL_DEFAULT_VALIDITY_MS 250
+
 #define ICE_DEVICE_ADDR 0x7
 #define FIRMWARE_VERSION_MAJOR 2
 #define FIRMWARE_VERSION_MINOR 3
@@ -47,9 +52,6 @@ int main()
     // Enable console.
     gleos::stdio_console_port();
 
-    // Set the watch deadtime to 2s.
-    // gleos::watchdog::start(2000);
-
     // Initialize all dual motor actuators.
     std::array<gleos::actuator::motor, 6> motor_pwm{
         // Index: 0; Actuate: Bucket
@@ -73,15 +75,22 @@ int main()
 
     // Open the data channel.
     gleos::uart serial{UART_ID, UART_TX_PIN, UART_RX_PIN};
-    gleos::ice::layer3 netlayer{serial, ICE_DEVICE_ADDR, {FIRMWARE_VERSION_MAJOR, FIRMWARE_VERSION_MINOR}};
+
+    // Sleep between frames rather than polling the link.
+    serial.enable_rx_irq();
+    gleos::ice::uart_transport link{serial};
+    gleos::ice::layer3 netlayer{link, ICE_DEVICE_ADDR, {FIRMWARE_VERSION_MAJOR, FIRMWARE_VERSION_MINOR}};
+
+    // The main loop is not supervised, it can wait on the network indefinitely.
+    gleos::watchdog::heartbeat announce_heartbeat{"announce", 2000};
 
     const auto periodic_update = [&]
     {
         // Announce this device on the network.
         netlayer.announce_device();
 
-        // Postpone deadline timer.
-        // gleos::watchdog::update();
+        // The announcement timer must keep running.
+        announce_heartbeat.beat();
 
         std::cout << "Announce device on network" << std::endl;
         std::cout << "Uptime: " << gleos::sec_since_boot() << " seconds" << std::endl;
@@ -89,66 +98,130 @@ int main()
         return true;
     };
 
-    gleos::timer_interval timer{gleos::ice::broadcast_service::default_interval, periodic_update};
+    // Everything which sends on the link runs from the main loop.
+    gleos::timer_interval timer{gleos::ice::broadcast_service::default_interval, periodic_update, "announce", gleos::timer_interval::mode::deferred};
+    gleos::ice::load_service load_service{gleos::ice::load_service::default_interval, netlayer};
+    gleos::ice::statistics_service stats_service{gleos::ice::statistics_service::default_interval, netlayer};
 
-    // Postpone deadline timer.
-    // gleos::watchdog::update();
+    // Follow the network time of the time server.
+    gleos::ice::network_clock network_clock;
+    gleos::ice::clock_sync clock_sync{netlayer, network_clock, gleos::ice::time_server_group};
+    gleos::ice::clock_sync_service sync_service{gleos::ice::clock_sync_service::default_interval, clock_sync};
 
-    while (true)
-    {
-        auto frame = netlayer.accept();
+    // Follow the link rate proposed by the host.
+    gleos::ice::link_control link_control{netlayer, link};
+
+    // Accounts the main loop, except for the time spent waiting on the network.
+    gleos::load::task main_task{"hydraulic.main"};
 
-        // gleos::watchdog::update();
+    gleos::stats::period loop_period{"hydraulic.loop"};
 
-        switch (frame.get<gleos::ice::packet>()->payload_type)
+    // Latency from the last byte of a control frame to the update
+    // of the PWM level. The byte is stamped in the receive interrupt.
+    gleos::stats::histogram control_latency{"hydraulic.latency"};
+    uint32_t frame_timestamp = 0;
+
+    // Age of timestamped control values at the update of the
+    // PWM level, from the network time stamped by the host.
+    gleos::stats::histogram control_age{"hydraulic.age"};
+    bool is_timestamped = false;
+    gleos::ice::timestamp_type network_timestamp = 0;
+
+    const auto record_age = [&]
+    {
+        if (is_timestamped && network_clock.is_synchronized())
         {
+            control_age.record(static_cast<gleos::ice::timestamp_type>(network_clock.now()) - network_timestamp);
+        }
+    };
+
+    const auto on_device_info = [&](const gleos::ice::device_info &dev_info)
+    {
+        link_control.observe(dev_info);
+
+        std::cout << "Device announcement" << '\n'
+                  << " Address: " << dev_info.address << '\n'
+                  << " Version: " << (dev_info.version >> 4) << "." << static_cast<int>(dev_info.version & ~0xf0) << '\n'
+                  << " Status: " << dev_info.status << std::endl;
+    };
 
-        case gleos::ice::payload::device_info_type:
+    const auto on_solenoid_control = [&](const gleos::ice::solenoid_control &solenoid_ctrl)
+    {
+        // In the exceptional case that halt is requested we
+        // instructed all motors to write an explicit 0 on both
+        // sides of the actuator.
+        if (solenoid_ctrl.is_halt())
         {
-            const auto dev_info = frame.get<gleos::ice::device_info>();
+            for (auto &pwm : motor_pwm)
+            {
+                pwm.set_motion_value(0);
+            }
 
-            std::cout << "Device announcement" << '\n'
-                      << " Address: " << dev_info->address << '\n'
-                      << " Version: " << (dev_info->version >> 4) << "." << static_cast<int>(dev_info->version & ~0xf0) << '\n'
-                      << " Status: " << dev_info->status << std::endl;
-            break;
+            control_latency.record_since(frame_timestamp);
+            record_age();
+
+            std::cout << "Halt all actuators" << std::endl;
         }
+        else if (solenoid_ctrl.id <= motor_pwm.size() - 1)
+        {
+            // The value is ramped down when no new value arrives within
+            // the validity. The host only has to send on change.
+            const uint32_t validity_ms = solenoid_ctrl.validity_ms != gleos::ice::solenoid_control::default_validity
+                                             ? solenoid_ctrl.validity_ms
+                                             : CONTROL_DEFAULT_VALIDITY_MS;
+
+            motor_pwm[solenoid_ctrl.id].set_motion_value(solenoid_ctrl.value, validity_ms);
 
-        case gleos::ice::payload::solenoid_control_type:
+            control_latency.record_since(frame_timestamp);
+            record_age();
+
+            // Print only after the update, so the output does not
+            // add to the control latency.
+            std::cout << "Move valve " << static_cast<int>(solenoid_ctrl.id) << " to value " << solenoid_ctrl.value << std::endl;
+        }
+        else
         {
-            const auto solenoid_ctrl = frame.get<gleos::ice::solenoid_control>();
+            std::cout << "Invalid solenoid id" << std::endl;
+        }
+    };
 
-            std::cout << "Request for valve control" << std::endl;
+    const auto on_time_sync = [&](const gleos::ice::time_sync &time_sync)
+    {
+        clock_sync.process(time_sync, frame_timestamp);
+    };
 
-            // In the exceptional case that halt is requested we
-            // instructed all motors to write an explicit 0 on both
-            // sides of the actuator.
-            if (solenoid_ctrl->is_halt())
-            {
-                for (auto &pwm : motor_pwm)
-                {
-                    pwm.set_all(0);
-                }
+    const auto on_link_rate = [&](const gleos::ice::link_rate &link_rate)
+    {
+        link_control.process(link_rate);
+    };
 
-                std::cout << "Halt all actuators" << std::endl;
-            }
-            else if (solenoid_ctrl->id <= motor_pwm.size() - 1)
-            {
-                std::cout << "Move valve " << static_cast<int>(solenoid_ctrl->id) << " to value " << solenoid_ctrl->value << std::endl;
+    gleos::ice::dispatcher<gleos::ice::device_info, gleos::ice::solenoid_control, gleos::ice::time_sync, gleos::ice::link_rate> dispatcher;
+    dispatcher.on<gleos::ice::device_info>(on_device_info);
+    dispatcher.on<gleos::ice::solenoid_control>(on_solenoid_control);
+    dispatcher.on<gleos::ice::time_sync>(on_time_sync);
+    dispatcher.on<gleos::ice::link_rate>(on_link_rate);
 
-                motor_pwm[solenoid_ctrl->id].set_motion_value(solenoid_ctrl->value);
-            }
-            else
-            {
-                std::cout << "Invalid solenoid id" << std::endl;
-            }
+    // Set the watch deadtime to 2s.
+    gleos::watchdog::supervise(2000);
+
+    while (true)
+    {
+        loop_period.mark();
 
-            break;
+        auto frame = netlayer.accept();
+
+        gleos::load::scope scope{main_task};
+
+        frame_timestamp = frame->timestamp();
+        is_timestamped = frame->has_network_timestamp();
+        if (is_timestamped)
+        {
+            network_timestamp = frame->network_timestamp();
         }
 
-        default:
+        if (!dispatcher.dispatch(*frame))
+        {
             std::cout << "Invalid payload type" << std::endl;
-            break;
         }
     }
 
@@ -8,7 +8,16 @@
  * of the included license.  See the LICENSE file for details.
  */
 
+#include "gleos/bench.h"
+#include "gleos/calibration.h"
+#include "gleos/filter.h"
 #include "gleos/layer3.h"
+#include "gleos/link.h"
+#include "gleos/pio_uart.h"
+#include "gleos/shell.h"
+#include "gleos/subscription.h"
+#include "gleos/timesync.h"
+#include "gleos/watchdog.h"
 
 #include "driver/icm20600.h"
 
@@ -18,6 +27,17 @@
 #define UART_TX_PIN 4
 #define UART_RX_PIN 5
 
+#define CONSOLE_TX_PIN 6
+#define CONSOLE_RX_PIN 7
+
+// Data ready line of the accelerometer.
+#define IMU_INT_PIN 22
+
+// The accelerometer runs at 1 kHz, the network gets 100 Hz.
+#define ACC_SAMPLE_RATE 1000
+#define ACC_OUTPUT_RATE 100
+#define ACC_CUTOFF 40
+
 #define ICE_DEVICE_ADDR 0x9
 #define FIRMWARE_VERSION_MAJOR 2
 #define FIRMWARE_VERSION_MINOR 3
@@ -29,19 +49,54 @@ int main()
 
     // Open the data channel.
     gleos::uart serial{UART_ID, UART_TX_PIN, UART_RX_PIN};
-    gleos::ice::layer3 netlayer{serial, ICE_DEVICE_ADDR, {FIRMWARE_VERSION_MAJOR, FIRMWARE_VERSION_MINOR}};
+
+    // Buffer received frames while the main loop reads the sensor.
+    serial.enable_rx_irq();
+    gleos::ice::uart_transport link{serial};
+    gleos::ice::layer3 netlayer{link, ICE_DEVICE_ADDR, {FIRMWARE_VERSION_MAJOR, FIRMWARE_VERSION_MINOR}};
 
     gleos::i2c::block i2c_0{20, 21, gleos::i2c::mode::fast_mode};
 
     icm20600 sensor{i2c_0};
 
+    // The main loop is paced by the sensor, one sample per data ready.
+    sensor.enable_data_ready_interrupt(true);
+    gleos::event::bind_gpio(IMU_INT_PIN, true, gleos::event::data_ready);
+
+    // Corrections are loaded from flash and applied on every read.
+    gleos::calibration::engine calibration;
+    sensor.set_calibration(&calibration.active(gleos::calibration::accelerometer),
+                           &calibration.active(gleos::calibration::gyroscope));
+
+    // The shell runs the calibration routines. It is polled from the
+    // main loop, which also feeds the calibration engine.
+    gleos::pio_uart console_serial{pio0, CONSOLE_TX_PIN, CONSOLE_RX_PIN};
+    gleos::shell console{console_serial};
+
+    // Burst read of the acceleration registers, including the scaling
+    // and correction of every read. Run with `bench i2c.acc`.
+    gleos::bench::benchmark acc_read_case{
+        "i2c.acc",
+        [](void *context)
+        {
+            int16_t x, y, z;
+            static_cast<icm20600 *>(context)->read_acc_vector3(x, y, z);
+        },
+        &sensor,
+    };
+
+    gleos::watchdog::heartbeat announce_heartbeat{"announce", 2000};
+
+    // A sensor read may not stall the main loop.
+    gleos::watchdog::heartbeat main_heartbeat{"imu.main", 500};
+
     const auto periodic_update = [&]
     {
         // Announce this device on the network.
         netlayer.announce_device();
 
-        // Postpone deadline timer.
-        // gleos::watchdog::update();
+        // The announcement timer must keep running.
+        announce_heartbeat.beat();
 
         std::cout << "Announce device on network" << std::endl;
         std::cout << "Uptime since boot: " << gleos::sec_since_boot() << " seconds" << std::endl;
@@ -49,10 +104,139 @@ int main()
         return true;
     };
 
-    gleos::timer_interval timer{gleos::ice::broadcast_service::default_interval, periodic_update};
+    // Everything which sends on the link runs from the main loop.
+    gleos::timer_interval timer{gleos::ice::broadcast_service::default_interval, periodic_update, "announce", gleos::timer_interval::mode::deferred};
+    gleos::ice::load_service load_service{gleos::ice::load_service::default_interval, netlayer};
+    gleos::ice::statistics_service stats_service{gleos::ice::statistics_service::default_interval, netlayer};
+
+    // Follow the network time of the time server.
+    gleos::ice::network_clock network_clock;
+    gleos::ice::clock_sync clock_sync{netlayer, network_clock, gleos::ice::time_server_group};
+    gleos::ice::clock_sync_service sync_service{gleos::ice::clock_sync_service::default_interval, clock_sync};
+
+    // Follow the link rate proposed by the host.
+    gleos::ice::link_control link_control{netlayer, link};
+
+    // Measurements are only sent to subscribers. Blocks go out at a
+    // tenth of the sample rate, single samples at the sample rate.
+    gleos::ice::subscription_table subscriptions{netlayer};
+    subscriptions.offer(gleos::ice::acceleration_block::type, ACC_OUTPUT_RATE / gleos::ice::vector3x16_block::capacity);
+    subscriptions.offer(gleos::ice::acceleration::type, ACC_OUTPUT_RATE);
+
+    // Packed payloads vary in length and go out whenever one is full,
+    // at no fixed rate. Every subscriber gets every payload.
+    subscriptions.offer(gleos::ice::acceleration_packed::type, 0);
+
+    uint32_t frame_timestamp = 0;
+
+    const auto on_time_sync = [&](const gleos::ice::time_sync &time_sync)
+    {
+        clock_sync.process(time_sync, frame_timestamp);
+    };
+
+    const auto on_link_rate = [&](const gleos::ice::link_rate &link_rate)
+    {
+        link_control.process(link_rate);
+    };
+
+    const auto on_subscribe = [&](const gleos::ice::subscribe &subscribe)
+    {
+        subscriptions.process(subscribe);
+    };
+
+    gleos::ice::dispatcher<gleos::ice::time_sync, gleos::ice::link_rate, gleos::ice::subscribe> dispatcher;
+    dispatcher.on<gleos::ice::time_sync>(on_time_sync);
+    dispatcher.on<gleos::ice::link_rate>(on_link_rate);
+    dispatcher.on<gleos::ice::subscribe>(on_subscribe);
+
+    // Accounts the main loop, except for the time spent waiting on the sensor.
+    gleos::load::task main_task{"imu.main"};
+
+    gleos::stats::period loop_period{"imu.loop"};
+
+    // Data ready pulses which did not arrive in time.
+    gleos::stats::counter ready_timeouts{"imu.ready.timeout"};
+
+    // Band-limit and decimate the acceleration before it goes on the
+    // link. The CIC stage decimates by 5 without multiplies, its order
+    // keeps the bands around 200 Hz which fold onto the passband down
+    // by 70 dB. The FIR stage takes out the CIC droop, removes the band
+    // from 60 Hz which folds onto the passband at the output rate, and
+    // decimates by 2. The passband up to the cutoff is flat within
+    // 0.05 dB, anything which aliases into it is down by 65 dB.
+    using acc_filter_type = gleos::filter::chain<gleos::filter::cic_decimator<6, 5>, gleos::filter::fir_decimator<41, 2>>;
+    static_assert(ACC_SAMPLE_RATE / acc_filter_type::decimation == ACC_OUTPUT_RATE);
+
+    static constexpr auto acc_taps = gleos::filter::cic_compensator<41, 6, 5>(ACC_CUTOFF, ACC_OUTPUT_RATE - ACC_CUTOFF, ACC_SAMPLE_RATE / 5, 66);
+    gleos::filter::vector3<acc_filter_type> acc_filter{{{}, {acc_taps}}};
+
+    // Group delay of the filter, stamps are moved back by it. The CIC
+    // stage delays 12 input samples, the FIR stage half its length.
+    constexpr uint32_t acc_filter_delay_us = 1000000 * 12 / ACC_SAMPLE_RATE + 1000000 * 20 / (ACC_SAMPLE_RATE / 5);
+
+    // Acceleration samples are sent in blocks to reduce the
+    // framing overhead on the link.
+    gleos::ice::vector3x16_block acc_block{};
+
+    // Delta encoded acceleration, at most half a second per payload.
+    gleos::packed::encoder<ACC_OUTPUT_RATE / 2> acc_encoder{gleos::ice::payload_size_max};
+    gleos::ice::timestamp_type packed_network_time = 0;
+    gleos::stats::gauge packed_samples{"imu.packed.samples"};
+
+    const auto publish_packed = [&]
+    {
+        gleos::ice::acceleration_packed payload;
+        acc_encoder.encode(payload.data);
+        packed_samples.set(static_cast<int32_t>(acc_encoder.count()));
+
+        if (network_clock.is_synchronized())
+        {
+            subscriptions.publish(payload, packed_network_time);
+        }
+        else
+        {
+            subscriptions.publish(payload);
+        }
+        acc_encoder.reset();
+    };
+
+    // Latency from the oldest sample in a block
+    // to the transmission of the block.
+    gleos::stats::histogram transmit_latency{"imu.latency"};
+    uint32_t block_timestamp = 0;
+
+    // Network time of the oldest sample in a block.
+    gleos::ice::timestamp_type block_network_time = 0;
+
+    // Set the watch deadtime to 2s.
+    gleos::watchdog::supervise(2000);
 
     while (true)
     {
+        // Wait for the next sample. Without the pulse the link and the
+        // shell are still served, but no sample is read.
+        const auto is_data_ready = gleos::event::wait(gleos::event::data_ready, std::chrono::milliseconds{2 * 1000 / ACC_SAMPLE_RATE});
+        if (!is_data_ready)
+        {
+            ++ready_timeouts;
+        }
+
+        loop_period.mark();
+        main_heartbeat.beat();
+
+        gleos::timer_interval::run_deferred();
+
+        // Handle the frames received so far without waiting on the network.
+        while (auto frame = netlayer.try_accept())
+        {
+            gleos::load::scope scope{main_task};
+
+            frame_timestamp = frame->timestamp();
+            dispatcher.dispatch(*frame);
+        }
+
+        console.poll();
+
         if (!sensor.driver_is_alive())
         {
             // TODO: Send this to other end.
@@ -63,12 +247,87 @@ int main()
             continue;
         }
 
+        if (!is_data_ready)
         {
+            continue;
+        }
+
+        {
+            gleos::load::scope scope{main_task};
+
             int16_t x, y, z;
+
+            // The gyroscope is only read during its bias capture.
+            if (calibration.is_capturing(gleos::calibration::gyroscope))
+            {
+                sensor.read_gyro_raw(x, y, z);
+                calibration.feed(gleos::calibration::gyroscope, x, y, z);
+            }
+
             sensor.read_acc_vector3(x, y, z);
-            std::cout << "Acc: X: " << x << " Y: " << y << " Z: " << z << std::endl;
 
-            netlayer.dispatch_acceleration(gleos::ice::address_family::broadcast, x, y, z);
+            calibration.feed(gleos::calibration::accelerometer, x, y, z);
+
+            if (!acc_filter.process(x, y, z))
+            {
+                continue;
+            }
+
+            // Samples are stamped once the clock follows the network.
+            const auto sample_network_time = static_cast<gleos::ice::timestamp_type>(network_clock.now() - acc_filter_delay_us);
+
+            if (subscriptions.is_subscribed(gleos::ice::acceleration::type))
+            {
+                const gleos::ice::acceleration sample{{x, y, z}};
+                if (network_clock.is_synchronized())
+                {
+                    subscriptions.publish(sample, sample_network_time);
+                }
+                else
+                {
+                    subscriptions.publish(sample);
+                }
+            }
+
+            if (subscriptions.is_subscribed(gleos::ice::acceleration_packed::type))
+            {
+                if (!acc_encoder.add(x, y, z))
+                {
+                    publish_packed();
+                    acc_encoder.add(x, y, z);
+                }
+
+                if (acc_encoder.count() == 1)
+                {
+                    packed_network_time = sample_network_time;
+                }
+            }
+            else
+            {
+                acc_encoder.reset();
+            }
+
+            if (!acc_block.count)
+            {
+                block_timestamp = time_us_32();
+                block_network_time = sample_network_time;
+            }
+
+            acc_block.samples[acc_block.count++] = {x, y, z};
+            if (acc_block.count == gleos::ice::vector3x16_block::capacity)
+            {
+                if (network_clock.is_synchronized())
+                {
+                    subscriptions.publish(gleos::ice::acceleration_block{acc_block}, block_network_time);
+                }
+                else
+                {
+                    subscriptions.publish(gleos::ice::acceleration_block{acc_block});
+                }
+                acc_block.count = 0;
+
+                transmit_latency.record_since(block_timestamp);
+            }
         }
 
         // {
@@ -0,0 +1,99 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos.h"
+
+namespace gleos::bench
+{
+    using routine_type = void (*)(void *context);
+    using check_type = bool (*)(void *context);
+
+    /**
+     * Benchmark case.
+     * 
+     * Cases register themselves on construction and can be run
+     * from the `bench` shell command. The name and context must
+     * outlive the case.
+     */
+    class benchmark
+    {
+    public:
+        const char *const name;
+        const routine_type routine;
+        void *const context;
+        const check_type check;
+
+        /**
+         * Construct and register benchmark case.
+         * 
+         * @param name      Static case name.
+         * @param routine   Routine under test, run once per iteration.
+         * @param context   Opaque value passed to the routine.
+         * @param check     Optional check of the routine against a
+         *                  reference, run before the case is measured.
+         *                  Returns false on a mismatch.
+         */
+        benchmark(const char *name, routine_type routine, void *context = nullptr, check_type check = nullptr);
+        benchmark(const benchmark &) = delete;
+        ~benchmark();
+    };
+
+    enum flags : uint8_t
+    {
+        none = 0x0,
+        /* Run each iteration with interrupts disabled. */
+        mask_interrupts = 0x1,
+        /* Flush the XIP cache before each iteration. */
+        flush_cache = 0x2,
+    };
+
+    /**
+     * Benchmark result in CPU cycles.
+     * 
+     * The measurement overhead is already subtracted.
+     */
+    struct result
+    {
+        uint32_t min;
+        uint32_t median;
+        uint32_t max;
+    };
+
+    /* Maximum number of iterations per run. */
+    constexpr size_t iterations_max = GLEOS_BENCH_ITERATIONS_MAX;
+
+    /**
+     * Run benchmark case.
+     * 
+     * Cycles are counted with the SysTick timer running from the
+     * system clock. A single iteration must not exceed 2^24 cycles.
+     * This function is not reentrant.
+     * 
+     * @param benchmark     Case to run.
+     * @param iterations    Number of iterations, at most iterations_max.
+     * @param flags         Run flags.
+     * @return              Cycle counts over all iterations.
+     */
+    result run(const benchmark &benchmark, size_t iterations, uint8_t flags = flags::none);
+
+    /**
+     * Number of registered cases.
+     */
+    size_t count() noexcept;
+
+    /**
+     * Registered case at index.
+     * 
+     * @return Case or nullptr if index is out of range.
+     */
+    const benchmark *at(size_t index) noexcept;
+} // gleos
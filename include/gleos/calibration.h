@@ -0,0 +1,238 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos.h"
+#include "fixed.h"
+#include "shell.h"
+
+#include "hardware/flash.h"
+
+namespace gleos::calibration
+{
+    /* Gain of the correction matrix, in [-2, 2). */
+    using gain = fixed<14, int16_t>;
+
+    /**
+     * Correction of a three axis sensor.
+     * 
+     * The corrected vector is `matrix * (vector - offset)`. The
+     * diagonal of the matrix holds the scale of each axis, the other
+     * elements the misalignment between the axes. All values are in
+     * the output unit of the sensor driver, except for the gyroscope
+     * which is corrected in raw counts.
+     */
+    struct correction
+    {
+        int16_t offset[3];
+        gain matrix[3][3];
+
+        /**
+         * Correction which leaves vectors unchanged.
+         */
+        constexpr static correction identity() noexcept
+        {
+            correction value{};
+
+            for (size_t i = 0; i < 3; ++i)
+            {
+                value.matrix[i][i] = gain::from(1.0);
+            }
+
+            return value;
+        }
+
+        /**
+         * Check if the correction can be applied without overflow.
+         * 
+         * The absolute sum of each row of the matrix must stay below 2.
+         */
+        bool is_valid() const noexcept;
+
+        /**
+         * Apply the correction in place.
+         */
+        void apply(int16_t &x, int16_t &y, int16_t &z) const noexcept;
+    };
+
+    enum sensor : uint8_t
+    {
+        /* Accelerometer, in mg. */
+        accelerometer,
+        /* Gyroscope, in raw counts. */
+        gyroscope,
+        /* Magnetometer, in uT. */
+        magnetometer,
+    };
+
+    /* Number of calibrated sensors. */
+    constexpr size_t sensor_count = 3;
+
+    /**
+     * Calibration flash file.
+     */
+    struct file
+    {
+        static const int offset = 1 * FLASH_SECTOR_SIZE;
+
+        correction corrections[sensor_count];
+    };
+
+    /**
+     * Sensor calibration engine.
+     * 
+     * Holds the live correction of each sensor. Drivers apply the
+     * correction from `active()` in their read path. Samples are
+     * fed to the engine while a capture runs. The corrections are
+     * stored in the flash file system and loaded on construction.
+     * 
+     * The engine registers the `calibrate` shell command, which runs
+     * the routines:
+     * 
+     * - Accelerometer: six-position routine. The device is held still
+     *   with each axis pointing up and down in turn. The offset, scale
+     *   and misalignment follow from the six mean vectors.
+     * - Gyroscope: bias capture at standstill, on raw counts. In
+     *   dps the bias would round to a whole degree per second.
+     * - Magnetometer: hard and soft iron fit from the extremes of each
+     *   axis while the device is turned in all directions. The soft
+     *   iron correction is aligned to the sensor axes.
+     * 
+     * A capture runs on uncorrected samples, the correction of the
+     * captured sensor is identity until the capture ends.
+     */
+    class engine
+    {
+    public:
+        /* Samples per capture. */
+        constexpr static uint16_t sample_count = GLEOS_CALIBRATION_SAMPLES;
+
+        /* Gravity in mg. */
+        constexpr static int32_t gravity = 1000;
+
+        enum position : uint8_t
+        {
+            x_up,
+            x_down,
+            y_up,
+            y_down,
+            z_up,
+            z_down,
+        };
+
+    private:
+        /**
+         * Running statistics of a capture.
+         */
+        struct accumulator
+        {
+            int32_t sum[3];
+            int16_t min[3];
+            int16_t max[3];
+            uint16_t count;
+
+            void reset() noexcept;
+            void add(int16_t x, int16_t y, int16_t z) noexcept;
+
+            /**
+             * Mean of axis, rounded.
+             */
+            int16_t mean(size_t axis) const noexcept;
+
+            /**
+             * Largest difference between two samples of any axis.
+             */
+            int32_t spread() const noexcept;
+        };
+
+        enum class state : uint8_t
+        {
+            idle,
+            capture,
+            sweep,
+        };
+
+        correction m_corrections[sensor_count];
+        correction m_saved{};
+        sensor m_sensor{accelerometer};
+        position m_position{x_up};
+        state m_state{state::idle};
+        accumulator m_accumulator{};
+        int16_t m_means[6][3]{};
+        uint8_t m_positions{0};
+        const char *m_result{nullptr};
+
+        shell::command m_command;
+
+        /**
+         * Begin a capture on sensor.
+         */
+        void begin(sensor target, state mode);
+
+        /**
+         * Finish the capture and fit the correction.
+         */
+        void finish();
+
+        /**
+         * End the capture with a result message.
+         * 
+         * The correction from before the capture is restored
+         * unless a new correction was fitted.
+         */
+        void end(const char *result, bool is_fitted);
+
+        bool fit_accelerometer();
+        bool fit_magnetometer();
+
+        static void command(const shell::arguments &args, shell::writer &out, void *context);
+
+    public:
+        /**
+         * Construct calibration engine.
+         * 
+         * Loads the corrections from flash, or identity if there
+         * is no calibration file.
+         */
+        engine();
+        engine(const engine &) = delete;
+
+        /**
+         * Live correction of sensor.
+         * 
+         * The reference stays valid for the lifetime of the engine.
+         */
+        inline const correction &active(sensor target) const noexcept
+        {
+            return m_corrections[target];
+        }
+
+        /**
+         * Check if samples of sensor are wanted.
+         */
+        inline bool is_capturing(sensor target) const noexcept
+        {
+            return m_state != state::idle && m_sensor == target;
+        }
+
+        /**
+         * Feed an uncorrected sample.
+         * 
+         * Samples of sensors which are not captured are ignored.
+         */
+        void feed(sensor source, int16_t x, int16_t y, int16_t z) noexcept;
+
+        /**
+         * Store the corrections in flash.
+         */
+        bool save();
+    };
+} // gleos
@@ -0,0 +1,100 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos.h"
+
+#include <array>
+
+namespace gleos
+{
+    namespace can
+    {
+        /**
+         * Maximum data length of a classic CAN message.
+         * 
+         * The ICE CAN transport carries the payload in the data field,
+         * so only payloads up to this length go over CAN. Extended
+         * payloads, such as statistics, histograms and CPU load, and
+         * timestamped payloads, such as time_sync or any frame sent
+         * with a network timestamp, exceed it. The transport drops
+         * them and counts them in `ice.tx.dropped`.
+         */
+        constexpr size_t data_length_max = 8;
+
+        /* Standard (11-bit) identifier mask. */
+        constexpr uint32_t standard_id_mask = 0x7ff;
+
+        /* Extended (29-bit) identifier mask. */
+        constexpr uint32_t extended_id_mask = 0x1fffffff;
+
+        /**
+         * Classic CAN message.
+         */
+        struct message
+        {
+            uint32_t id;
+            bool is_extended;
+            uint8_t length;
+            std::array<uint8_t, data_length_max> data;
+        };
+
+        /**
+         * CAN controller interface.
+         * 
+         * It is recommended that all CAN controller drivers
+         * implement this interface.
+         */
+        class controller
+        {
+        public:
+            /**
+             * Queue message for transmission.
+             * 
+             * @param msg   Message to send.
+             * @return      True if the message was queued, false otherwise.
+             */
+            virtual bool write(const message &msg) = 0;
+
+            /**
+             * Abort the pending transmission.
+             * 
+             * A message which no node acknowledges is retransmitted
+             * until it is aborted.
+             */
+            virtual void abort() = 0;
+
+            /**
+             * Read the next received message.
+             * 
+             * This method does not block.
+             * 
+             * @param msg   Received message.
+             * @return      True if a message was read, false otherwise.
+             */
+            virtual bool read(message &msg) = 0;
+
+            /**
+             * Program the hardware acceptance filters.
+             * 
+             * Only extended messages for which `(msg.id & mask)` matches
+             * one of `(ids[n] & mask)` are passed on to the receive
+             * buffers. All other messages are dropped by the controller.
+             * 
+             * @param mask  Identifier bits which must match.
+             * @param ids   Accepted identifiers.
+             * @param count Number of accepted identifiers.
+             * @return      True if the filters could be applied, false otherwise.
+             */
+            virtual bool set_acceptance_filter(uint32_t mask, const uint32_t *ids, size_t count) = 0;
+        };
+    }
+}
@@ -0,0 +1,201 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos.h"
+
+#include "pico/time.h"
+#include "hardware/structs/timer.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace gleos
+{
+    /**
+     * Monotonic system clock.
+     * 
+     * The clock counts microseconds since boot in 64 bits and does not
+     * wrap during the lifetime of the device. It satisfies the standard
+     * clock requirements, so the `std::chrono` durations and literals
+     * can be used with it. Reading the clock takes a few register reads
+     * and no division.
+     */
+    class clock
+    {
+    public:
+        using rep = int64_t;
+        using period = std::micro;
+        using duration = std::chrono::duration<rep, period>;
+        using time_point = std::chrono::time_point<clock, duration>;
+
+        constexpr static bool is_steady = true;
+
+        /**
+         * Microseconds since boot.
+         */
+        static inline uint64_t now_us() noexcept
+        {
+            // The raw registers do not latch. Read the high word on both
+            // sides of the low word to catch a carry in between.
+            uint32_t hi = timer_hw->timerawh;
+            uint32_t lo;
+
+            while (true)
+            {
+                lo = timer_hw->timerawl;
+
+                const uint32_t hi_next = timer_hw->timerawh;
+                if (hi == hi_next)
+                {
+                    break;
+                }
+
+                hi = hi_next;
+            }
+
+            return (static_cast<uint64_t>(hi) << 32) | lo;
+        }
+
+        /**
+         * Current time.
+         */
+        static inline time_point now() noexcept
+        {
+            return time_point{duration{static_cast<rep>(now_us())}};
+        }
+
+        /**
+         * Convert time point to SDK absolute time.
+         */
+        static inline absolute_time_t to_absolute_time(time_point time) noexcept
+        {
+            return from_us_since_boot(static_cast<uint64_t>(time.time_since_epoch().count()));
+        }
+
+        /**
+         * Convert SDK absolute time to time point.
+         */
+        static inline time_point from_absolute_time(absolute_time_t time) noexcept
+        {
+            return time_point{duration{static_cast<rep>(to_us_since_boot(time))}};
+        }
+    };
+
+    namespace detail
+    {
+        /**
+         * Divide 64-bit value by a 16-bit divisor.
+         * 
+         * The division is done in 16-bit digits so each step only takes
+         * a 32-bit division, which runs on the hardware divider. This
+         * avoids the 64-bit software division of the runtime library.
+         */
+        constexpr uint64_t divide(uint64_t value, uint16_t divisor) noexcept
+        {
+            uint64_t quotient = 0;
+            uint32_t remainder = 0;
+
+            for (int shift = 48; shift >= 0; shift -= 16)
+            {
+                const uint32_t dividend = (remainder << 16) | static_cast<uint32_t>((value >> shift) & 0xffff);
+
+                quotient = (quotient << 16) | (dividend / divisor);
+                remainder = dividend % divisor;
+            }
+
+            return quotient;
+        }
+    }
+
+    /**
+     * Whole milliseconds in duration.
+     * 
+     * Negative durations are returned as zero.
+     */
+    constexpr uint64_t to_ms(clock::duration duration) noexcept
+    {
+        return duration.count() > 0 ? detail::divide(static_cast<uint64_t>(duration.count()), 1000) : 0;
+    }
+
+    /**
+     * Whole seconds in duration.
+     * 
+     * Negative durations are returned as zero.
+     */
+    constexpr uint64_t to_seconds(clock::duration duration) noexcept
+    {
+        return detail::divide(to_ms(duration), 1000);
+    }
+
+    static_assert(to_ms(std::chrono::hours{24 * 365 * 100}) == 3153600000000ull);
+    static_assert(to_seconds(std::chrono::milliseconds{1999}) == 1);
+
+    /**
+     * Point in time after which a wait is given up.
+     * 
+     * Compare against the deadline instead of counting down a timeout,
+     * so the time spent in between is accounted for.
+     */
+    class deadline
+    {
+        clock::time_point m_expiry;
+
+    public:
+        /**
+         * Deadline at a point in time.
+         */
+        constexpr explicit deadline(clock::time_point expiry) noexcept
+            : m_expiry{expiry}
+        {
+        }
+
+        /**
+         * Deadline after a timeout from now.
+         */
+        explicit deadline(clock::duration timeout) noexcept
+            : m_expiry{clock::now() + timeout}
+        {
+        }
+
+        inline clock::time_point expiry() const noexcept
+        {
+            return m_expiry;
+        }
+
+        /**
+         * Check if the deadline has passed.
+         */
+        inline bool is_expired() const noexcept
+        {
+            return clock::now() >= m_expiry;
+        }
+
+        /**
+         * Time left until the deadline, zero once it has passed.
+         */
+        inline clock::duration remaining() const noexcept
+        {
+            return std::max(m_expiry - clock::now(), clock::duration::zero());
+        }
+
+        /**
+         * Move the deadline by a period.
+         * 
+         * Advancing from the previous expiry instead of from now
+         * keeps a periodic schedule free of drift.
+         */
+        inline void advance(clock::duration period) noexcept
+        {
+            m_expiry += period;
+        }
+    };
+} // gleos
@@ -13,6 +13,69 @@
 /* Default UART baud rate. */
 #define GLEOS_DEFAULT_UART_BAUD_RATE 115200
 
+/* Highest ICE link baud rate supported by the transceiver. */
+#define GLEOS_ICE_LINK_BAUD_RATE_MAX 3000000
+
+/* Consecutive corrupt frames after which the ICE link falls back to the base rate. */
+#define GLEOS_ICE_LINK_FALLBACK_ERRORS 8
+
+/* Time an ICE frame may wait for the CAN transmit buffer in microseconds. */
+#define GLEOS_ICE_CAN_TX_TIMEOUT_US 5000
+
+/* Number of frames in the ICE frame pool. */
+#define GLEOS_ICE_FRAME_POOL_SIZE 8
+
+/* Number of entries in an ICE subscription table. */
+#define GLEOS_ICE_SUBSCRIPTION_CAPACITY 8
+
+/* Number of measurements an ICE subscription table can offer. */
+#define GLEOS_ICE_OFFER_CAPACITY 4
+
+/* Maximum number of registered statistics. */
+#define GLEOS_STATS_REGISTRY_SIZE 64
+
+/* Default I2C transfer timeout in microseconds. */
+#define GLEOS_DEFAULT_I2C_TIMEOUT_US 10000
+
+/* Maximum number of registered shell commands. */
+#define GLEOS_SHELL_REGISTRY_SIZE 24
+
+/* Maximum length of a shell command line. */
+#define GLEOS_SHELL_LINE_LENGTH 64
+
+/* Size of the shell output buffer in bytes. */
+#define GLEOS_SHELL_OUTPUT_BUFFER_SIZE 2048
+
+/* Maximum number of registered benchmark cases. */
+#define GLEOS_BENCH_REGISTRY_SIZE 24
+
+/* Maximum number of iterations per benchmark run. */
+#define GLEOS_BENCH_ITERATIONS_MAX 64
+
+/* Maximum number of accounted tasks. */
+#define GLEOS_LOAD_REGISTRY_SIZE 16
+
+/* Maximum number of supervised heartbeats. */
+#define GLEOS_WATCHDOG_REGISTRY_SIZE 8
+
+/* Maximum number of peripherals retimed on a clock change. */
+#define GLEOS_POWER_REGISTRY_SIZE 16
+
+/* Size of the interrupt driven UART receive buffer. */
+#define GLEOS_UART_RX_BUFFER_SIZE 256
+
+/* Size of the PIO UART receive ring buffer as a power of two. */
+#define GLEOS_PIO_UART_RX_RING_BITS 8
+
+/* Size of the PIO UART transmit buffer. */
+#define GLEOS_PIO_UART_TX_BUFFER_SIZE 128
+
+/* Number of samples per sensor calibration capture. */
+#define GLEOS_CALIBRATION_SAMPLES 256
+
+/* Event wake-up latency bound in microseconds. */
+#define GLEOS_EVENT_WAKE_LATENCY_US 100
+
 /* Firmware major version */
 #define GLEOS_FIRMWARE_VERSION_MAJOR 2
 /* Firmware minor version */
@@ -0,0 +1,90 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos.h"
+#include "clock.h"
+
+namespace gleos::event
+{
+    /**
+     * Event flags.
+     * 
+     * The low flags are posted by the operating system. Firmware
+     * can use the flags from `user` upwards for its own events.
+     */
+    enum flag : uint32_t
+    {
+        /* Data was received on an interrupt driven UART. */
+        uart_rx = 0x1,
+        /* A timer has expired. */
+        timer = 0x2,
+        /* A sensor signalled data ready on its interrupt line. */
+        data_ready = 0x4,
+        /* First flag for firmware use. */
+        user = 0x100,
+    };
+
+    /* Wake-up latency above which a wake-up is counted as late. */
+    constexpr uint32_t wake_latency_max_us = GLEOS_EVENT_WAKE_LATENCY_US;
+
+    /**
+     * Post events.
+     * 
+     * This function is safe to call from interrupt handlers. Any core
+     * sleeping in `wait` wakes up.
+     * 
+     * @param flags Events to post.
+     */
+    void post(uint32_t flags) noexcept;
+
+    /**
+     * Wait for any of the events.
+     * 
+     * The core sleeps until an event arrives. The returned events are
+     * cleared, other pending events are left set. The time from the
+     * post to the return of this function is recorded as wake-up
+     * latency. Do not call this function from an interrupt handler.
+     * 
+     * @param mask  Events to wait for.
+     * @return      Posted events in mask.
+     */
+    uint32_t wait(uint32_t mask) noexcept;
+
+    /**
+     * Wait for any of the events or until the timeout expires.
+     * 
+     * @param mask      Events to wait for.
+     * @param timeout   Maximum time to wait.
+     * @return          Posted events in mask, or zero on timeout.
+     */
+    uint32_t wait(uint32_t mask, clock::duration timeout) noexcept;
+
+    /**
+     * Take posted events without waiting.
+     * 
+     * @param mask  Events to take.
+     * @return      Posted events in mask.
+     */
+    uint32_t take(uint32_t mask) noexcept;
+
+    /**
+     * Post events on a GPIO edge.
+     * 
+     * Use this for the data-ready line of a sensor. Each pin can
+     * post its own events.
+     * 
+     * @param gpio      Pin number.
+     * @param rising    Post on the rising edge, else on the falling edge.
+     * @param flags     Events to post.
+     */
+    void bind_gpio(unsigned int gpio, bool rising, uint32_t flags) noexcept;
+} // gleos
@@ -0,0 +1,567 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos.h"
+#include "fixed.h"
+
+#include <array>
+#include <limits>
+#include <tuple>
+
+namespace gleos::filter
+{
+    /*
+     * Filter stages take one 16-bit sample at a time. A stage has
+     * 
+     *   constexpr static size_t decimation;
+     *   bool process(int16_t in, int16_t &out) noexcept;
+     * 
+     * where process returns true when an output sample is written,
+     * which is once per `decimation` input samples. Stages are
+     * composed with `chain` and run per axis with `vector3`.
+     * 
+     * Coefficients are designed at compile time and stored in
+     * fixed-point, no floating point code ends up in the firmware.
+     */
+
+    namespace detail
+    {
+        constexpr long double pi = 3.141592653589793238462643383279502884l;
+
+        /**
+         * Sine for coefficient design at compile time.
+         */
+        constexpr long double sin(long double x)
+        {
+            while (x > pi)
+            {
+                x -= 2 * pi;
+            }
+            while (x < -pi)
+            {
+                x += 2 * pi;
+            }
+
+            long double term = x;
+            long double sum = x;
+            for (int n = 1; n < 20; ++n)
+            {
+                term *= -x * x / ((2 * n) * (2 * n + 1));
+                sum += term;
+            }
+
+            return sum;
+        }
+
+        constexpr long double cos(long double x)
+        {
+            return sin(x + pi / 2);
+        }
+
+        constexpr long double sqrt(long double x)
+        {
+            if (x <= 0)
+            {
+                return 0;
+            }
+
+            long double root = x < 1 ? 1 : x;
+            for (int n = 0; n < 64; ++n)
+            {
+                root = (root + x / root) / 2;
+            }
+
+            return root;
+        }
+
+        /**
+         * Modified Bessel function of the first kind, order zero.
+         */
+        constexpr long double bessel_i0(long double x)
+        {
+            long double term = 1;
+            long double sum = 1;
+            for (int k = 1; k < 40; ++k)
+            {
+                term *= (x / (2 * k)) * (x / (2 * k));
+                sum += term;
+            }
+
+            return sum;
+        }
+
+        /**
+         * Magnitude response of a CIC decimator.
+         * 
+         * @param f     Frequency as a fraction of the output rate.
+         */
+        constexpr long double cic_response(long double f, size_t order, size_t factor)
+        {
+            if (f == 0)
+            {
+                return 1;
+            }
+
+            const auto ratio = sin(pi * f) / (factor * sin(pi * f / factor));
+
+            long double value = 1;
+            for (size_t i = 0; i < order; ++i)
+            {
+                value *= ratio;
+            }
+
+            return value < 0 ? -value : value;
+        }
+
+        /**
+         * Quantize a designed coefficient, rounded to nearest.
+         */
+        template <typename F>
+        constexpr F quantize(long double value)
+        {
+            const auto scaled = value * static_cast<long double>(1ll << F::frac_bits);
+            const auto rounded = static_cast<int64_t>(scaled < 0 ? scaled - 0.5l : scaled + 0.5l);
+
+            if (rounded > std::numeric_limits<typename F::rep>::max() || rounded < std::numeric_limits<typename F::rep>::min())
+            {
+                gleos::detail::constant_out_of_range();
+            }
+
+            return F::from_raw(static_cast<typename F::rep>(rounded));
+        }
+
+        /**
+         * Quantize designed taps for unity gain at DC.
+         * 
+         * The center tap takes the rounding of the others.
+         */
+        template <size_t Taps>
+        constexpr std::array<q15, Taps> quantize_taps(const long double (&h)[Taps])
+        {
+            long double sum = 0;
+            for (const auto value : h)
+            {
+                sum += value;
+            }
+
+            std::array<q15, Taps> taps;
+            int32_t raw_sum = 0;
+
+            for (size_t n = 0; n < Taps; ++n)
+            {
+                taps[n] = quantize<q15>(h[n] / sum);
+                raw_sum += taps[n].raw();
+            }
+
+            const auto center_raw = taps[Taps / 2].raw() + (1 << q15::frac_bits) - raw_sum;
+            if (center_raw > INT16_MAX)
+            {
+                gleos::detail::constant_out_of_range();
+            }
+
+            taps[Taps / 2] = q15::from_raw(static_cast<int16_t>(center_raw));
+
+            return taps;
+        }
+    }
+
+    /* Coefficient of a biquad section, in [-2, 2). */
+    using coefficient = fixed<14, int16_t>;
+
+    /**
+     * Coefficients of a biquad section.
+     * 
+     * The transfer function is
+     * `(b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2)`.
+     */
+    struct biquad_coefficients
+    {
+        coefficient b0;
+        coefficient b1;
+        coefficient b2;
+        coefficient a1;
+        coefficient a2;
+    };
+
+    /**
+     * Design a second order low-pass section.
+     * 
+     * The section is quantized for unity gain at DC. Cutoffs too low
+     * for the coefficient range fail to compile.
+     * 
+     * @param cutoff        Cutoff frequency.
+     * @param sample_rate   Sample rate in the same unit.
+     * @param q             Quality factor, the default is Butterworth.
+     */
+    consteval biquad_coefficients lowpass(long double cutoff, long double sample_rate, long double q = 0.7071067811865475l)
+    {
+        const auto w0 = 2 * detail::pi * cutoff / sample_rate;
+        const auto alpha = detail::sin(w0) / (2 * q);
+        const auto cos_w0 = detail::cos(w0);
+        const auto a0 = 1 + alpha;
+
+        biquad_coefficients value{
+            b0 : detail::quantize<coefficient>((1 - cos_w0) / 2 / a0),
+            b1 : {},
+            b2 : detail::quantize<coefficient>((1 - cos_w0) / 2 / a0),
+            a1 : detail::quantize<coefficient>(-2 * cos_w0 / a0),
+            a2 : detail::quantize<coefficient>((1 - alpha) / a0),
+        };
+
+        // The middle tap takes the rounding of the others so the
+        // quantized numerator equals the quantized denominator at DC.
+        constexpr int32_t one = 1 << coefficient::frac_bits;
+        value.b1 = coefficient::from_raw(static_cast<int16_t>(one + value.a1.raw() + value.a2.raw() - value.b0.raw() - value.b2.raw()));
+
+        return value;
+    }
+
+    /**
+     * Biquad IIR section.
+     * 
+     * Direct form I with the truncation error of the output fed back
+     * into the next sample. This keeps the rounding noise away from
+     * DC and prevents limit cycles at low cutoffs.
+     */
+    class biquad
+    {
+        biquad_coefficients m_coefficients;
+        int16_t m_x1{0}, m_x2{0};
+        int16_t m_y1{0}, m_y2{0};
+        int32_t m_error{0};
+
+    public:
+        constexpr static size_t decimation = 1;
+
+        constexpr biquad(const biquad_coefficients &coefficients) noexcept
+            : m_coefficients{coefficients} {}
+
+        inline bool process(int16_t in, int16_t &out) noexcept
+        {
+            const auto &c = m_coefficients;
+
+            // Each product fits 31 bits, the sum may not.
+            const int64_t sum = static_cast<int64_t>(m_error) +
+                                c.b0.raw() * in +
+                                c.b1.raw() * m_x1 +
+                                c.b2.raw() * m_x2 -
+                                c.a1.raw() * m_y1 -
+                                c.a2.raw() * m_y2;
+
+            const auto y = gleos::detail::saturate<int16_t>(sum >> coefficient::frac_bits);
+
+            m_error = static_cast<int32_t>(sum & ((1 << coefficient::frac_bits) - 1));
+
+            m_x2 = m_x1;
+            m_x1 = in;
+            m_y2 = m_y1;
+            m_y1 = y;
+
+            out = y;
+            return true;
+        }
+    };
+
+    /* Taps of a FIR filter. */
+    template <size_t Taps>
+    using fir_coefficients = std::array<q15, Taps>;
+
+    /**
+     * Design a linear phase low-pass FIR filter.
+     * 
+     * Windowed sinc with a Hamming window. The taps are quantized
+     * for unity gain at DC.
+     * 
+     * @param cutoff        Cutoff frequency.
+     * @param sample_rate   Sample rate in the same unit.
+     */
+    template <size_t Taps>
+    consteval fir_coefficients<Taps> lowpass_fir(long double cutoff, long double sample_rate)
+    {
+        static_assert(Taps % 2 == 1, "linear phase low-pass takes an odd number of taps");
+
+        const auto fc = cutoff / sample_rate;
+        const auto center = static_cast<long double>(Taps / 2);
+
+        long double h[Taps];
+
+        for (size_t n = 0; n < Taps; ++n)
+        {
+            const auto m = n - center;
+            const auto sinc = m == 0 ? 2 * fc : detail::sin(2 * detail::pi * fc * m) / (detail::pi * m);
+            const auto window = 0.54l - 0.46l * detail::cos(2 * detail::pi * n / (Taps - 1));
+
+            h[n] = sinc * window;
+        }
+
+        return detail::quantize_taps(h);
+    }
+
+    /**
+     * Design a linear phase low-pass FIR filter behind a CIC decimator.
+     * 
+     * The passband follows the inverse of the CIC response, which takes
+     * out the droop of the CIC stage. Windowed design with a Kaiser
+     * window for the given stopband attenuation. The transition band
+     * lies between the passband and stopband edges, its width sets the
+     * number of taps: about `(attenuation - 8) / (14.36 * width)`, with
+     * the width as a fraction of the sample rate. The taps are quantized
+     * for unity gain at DC.
+     * 
+     * @param passband      Passband edge.
+     * @param stopband      Stopband edge.
+     * @param sample_rate   Sample rate in the same unit, the CIC output rate.
+     * @param attenuation   Stopband attenuation in dB, at least 50.
+     */
+    template <size_t Taps, size_t Order, size_t Factor>
+    consteval fir_coefficients<Taps> cic_compensator(long double passband, long double stopband, long double sample_rate, long double attenuation)
+    {
+        static_assert(Taps % 2 == 1, "linear phase low-pass takes an odd number of taps");
+
+        if (attenuation < 50)
+        {
+            gleos::detail::constant_out_of_range();
+        }
+
+        // Ideal response sampled at the midpoints of the band up to the
+        // cutoff, the Kaiser window smooths the edge at the cutoff.
+        constexpr size_t points = 256;
+
+        const auto fc = (passband + stopband) / 2 / sample_rate;
+        const auto beta = 0.1102l * (attenuation - 8.7l);
+        const auto center = static_cast<long double>(Taps / 2);
+
+        long double desired[points];
+        for (size_t k = 0; k < points; ++k)
+        {
+            desired[k] = 1 / detail::cic_response(fc * (k + 0.5l) / points, Order, Factor);
+        }
+
+        long double h[Taps];
+
+        for (size_t n = 0; n < Taps; ++n)
+        {
+            const auto m = n - center;
+
+            long double ideal = 0;
+            for (size_t k = 0; k < points; ++k)
+            {
+                ideal += desired[k] * detail::cos(2 * detail::pi * fc * (k + 0.5l) / points * m);
+            }
+            ideal *= 2 * fc / points;
+
+            const auto position = 2 * n / static_cast<long double>(Taps - 1) - 1;
+            const auto window = detail::bessel_i0(beta * detail::sqrt(1 - position * position)) / detail::bessel_i0(beta);
+
+            h[n] = ideal * window;
+        }
+
+        return detail::quantize_taps(h);
+    }
+
+    /**
+     * Decimating FIR filter.
+     * 
+     * Only the kept outputs are computed, each input sample meets
+     * the taps of a single polyphase branch. That is `Taps / Factor`
+     * multiplies per input sample. The sum is kept in 64 bits, long
+     * designs with an absolute tap sum beyond 2 cannot overflow it.
+     * 
+     * The taps are referenced, not copied. Declare them constexpr
+     * with static storage so they stay in flash.
+     */
+    template <size_t Taps, size_t Factor>
+    class fir_decimator
+    {
+        static_assert(Factor > 0 && Taps >= Factor);
+
+        const fir_coefficients<Taps> &m_taps;
+
+        // The history is written twice so the newest Taps samples are
+        // always contiguous, starting at m_position.
+        int16_t m_history[2 * Taps]{};
+        size_t m_position{0};
+        size_t m_phase{0};
+
+    public:
+        constexpr static size_t decimation = Factor;
+
+        constexpr fir_decimator(const fir_coefficients<Taps> &taps) noexcept
+            : m_taps{taps} {}
+
+        inline bool process(int16_t in, int16_t &out) noexcept
+        {
+            m_position = (m_position == 0 ? Taps : m_position) - 1;
+            m_history[m_position] = in;
+            m_history[m_position + Taps] = in;
+
+            if (++m_phase < Factor)
+            {
+                return false;
+            }
+
+            m_phase = 0;
+
+            const int16_t *history = &m_history[m_position];
+
+            int64_t sum = 1 << (q15::frac_bits - 1);
+            for (size_t k = 0; k < Taps; ++k)
+            {
+                sum += m_taps[k].raw() * history[k];
+            }
+
+            out = gleos::detail::saturate<int16_t>(sum >> q15::frac_bits);
+            return true;
+        }
+    };
+
+    /**
+     * Cascaded integrator comb decimator.
+     * 
+     * Decimation without multiplies: Order integrators at the input
+     * rate and Order combs at the output rate. The response is
+     * sinc^Order with nulls at multiples of the output rate, which
+     * suits large factors ahead of a FIR stage. The gain of the
+     * filter is removed with a single multiply per output.
+     * 
+     * The integrators wrap, which the combs undo as long as the
+     * output fits 32 bits.
+     */
+    template <size_t Order, size_t Factor>
+    class cic_decimator
+    {
+        constexpr static uint64_t gain()
+        {
+            uint64_t value = 1;
+            for (size_t i = 0; i < Order; ++i)
+            {
+                value *= Factor;
+            }
+            return value;
+        }
+
+        static_assert(Order > 0 && Factor > 1);
+        static_assert(gain() <= (1 << 16), "bit growth exceeds 32 bits");
+
+        constexpr static auto normalization = fixed<30, int32_t>::from(1.0l / gain());
+
+        uint32_t m_integrators[Order]{};
+        uint32_t m_combs[Order]{};
+        size_t m_phase{0};
+
+    public:
+        constexpr static size_t decimation = Factor;
+
+        inline bool process(int16_t in, int16_t &out) noexcept
+        {
+            uint32_t value = static_cast<uint32_t>(static_cast<int32_t>(in));
+            for (auto &integrator : m_integrators)
+            {
+                integrator += value;
+                value = integrator;
+            }
+
+            if (++m_phase < Factor)
+            {
+                return false;
+            }
+
+            m_phase = 0;
+
+            for (auto &comb : m_combs)
+            {
+                const auto delayed = comb;
+                comb = value;
+                value -= delayed;
+            }
+
+            out = scale<int16_t>(static_cast<int32_t>(value), normalization);
+            return true;
+        }
+    };
+
+    /**
+     * Stages in series.
+     * 
+     * The decimation of the chain is the product of its stages. A
+     * stage only runs when the stage before it has an output.
+     */
+    template <typename... Stages>
+    class chain
+    {
+        std::tuple<Stages...> m_stages;
+
+    public:
+        constexpr static size_t decimation = (Stages::decimation * ...);
+
+        constexpr chain(Stages... stages) noexcept
+            : m_stages{stages...} {}
+
+        inline bool process(int16_t in, int16_t &out) noexcept
+        {
+            return std::apply(
+                [&](auto &...stage)
+                {
+                    int16_t value = in;
+                    if ((stage.process(value, value) && ...))
+                    {
+                        out = value;
+                        return true;
+                    }
+                    return false;
+                },
+                m_stages);
+        }
+    };
+
+    /**
+     * Stage on each axis of a vector.
+     * 
+     * All axes decimate in lockstep.
+     */
+    template <typename Stage>
+    class vector3
+    {
+        Stage m_axes[3];
+
+    public:
+        constexpr static size_t decimation = Stage::decimation;
+
+        constexpr vector3(const Stage &stage) noexcept
+            : m_axes{stage, stage, stage} {}
+
+        /**
+         * Filter a vector.
+         * 
+         * The vector is replaced by the output if there is one.
+         * 
+         * @return True if an output was written, false otherwise.
+         */
+        inline bool process(int16_t &x, int16_t &y, int16_t &z) noexcept
+        {
+            int16_t out[3];
+
+            const auto is_ready = m_axes[0].process(x, out[0]);
+            m_axes[1].process(y, out[1]);
+            m_axes[2].process(z, out[2]);
+
+            if (is_ready)
+            {
+                x = out[0];
+                y = out[1];
+                z = out[2];
+            }
+
+            return is_ready;
+        }
+    };
+} // gleos
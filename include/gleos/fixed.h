@@ -0,0 +1,266 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos.h"
+
+#include <compare>
+#include <limits>
+#include <type_traits>
+
+namespace gleos
+{
+    namespace detail
+    {
+        /**
+         * Clamp value to the range of type T.
+         */
+        template <typename T, typename W>
+        constexpr T saturate(W value) noexcept
+        {
+            if (value > static_cast<W>(std::numeric_limits<T>::max()))
+            {
+                return std::numeric_limits<T>::max();
+            }
+            if (value < static_cast<W>(std::numeric_limits<T>::min()))
+            {
+                return std::numeric_limits<T>::min();
+            }
+
+            return static_cast<T>(value);
+        }
+
+        /**
+         * Shift right and round to nearest, halves round up.
+         */
+        template <typename W>
+        constexpr W round_shift(W value, int shift) noexcept
+        {
+            if (shift <= 0)
+            {
+                return value << -shift;
+            }
+
+            return (value + (static_cast<W>(1) << (shift - 1))) >> shift;
+        }
+
+        /**
+         * Reject a constant at compile time.
+         * 
+         * Not constexpr, so a call fails constant evaluation with the
+         * name of this function in the diagnostic. The firmware is built
+         * without exceptions, a throw is not an option there.
+         */
+        inline void constant_out_of_range() noexcept {}
+    }
+
+    /**
+     * Signed fixed-point number in Q-format.
+     * 
+     * The value is stored as an integer of type T scaled by 2^Frac.
+     * The number of fractional bits may exceed the width of T, which
+     * suits small scale factors. Arithmetic rounds to nearest and
+     * saturates at the range of T instead of wrapping.
+     * 
+     * Products of 16-bit numbers are computed in 32 bits, products of
+     * 32-bit numbers in 64 bits, neither takes a division. Quotients
+     * of 16-bit numbers with at most 15 fractional bits run on the
+     * hardware divider.
+     */
+    template <int Frac, typename T = int32_t>
+    class fixed
+    {
+        static_assert(std::is_signed_v<T> && sizeof(T) <= sizeof(int32_t));
+        static_assert(Frac >= 0 && Frac < 31);
+
+        T m_raw{0};
+
+    public:
+        using rep = T;
+
+        /* Integer type wide enough to hold a product of two representations. */
+        using wide_type = std::conditional_t<sizeof(T) <= sizeof(int16_t), int32_t, int64_t>;
+
+        /* Integer type wide enough to hold a representation shifted by Frac. */
+        using dividend_type = std::conditional_t<(Frac + 8 * sizeof(T) > 31), int64_t, int32_t>;
+
+        constexpr static int frac_bits = Frac;
+
+        constexpr fixed() noexcept = default;
+
+        /**
+         * Number from its representation.
+         */
+        constexpr static fixed from_raw(T raw) noexcept
+        {
+            fixed value;
+            value.m_raw = raw;
+            return value;
+        }
+
+        /**
+         * Number from a constant.
+         * 
+         * Evaluated at compile time only, so no floating point code ends
+         * up in the firmware. Constants out of range fail to compile.
+         */
+        consteval static fixed from(long double value)
+        {
+            const auto scaled = value * static_cast<long double>(1ll << Frac);
+            const auto rounded = static_cast<int64_t>(scaled < 0 ? scaled - 0.5l : scaled + 0.5l);
+
+            if (rounded > std::numeric_limits<T>::max() || rounded < std::numeric_limits<T>::min())
+            {
+                detail::constant_out_of_range();
+            }
+
+            return from_raw(static_cast<T>(rounded));
+        }
+
+        /**
+         * Number from an integer, saturated.
+         */
+        constexpr static fixed from_int(int32_t value) noexcept
+        {
+            return from_raw(detail::saturate<T>(static_cast<int64_t>(value) << Frac));
+        }
+
+        constexpr T raw() const noexcept
+        {
+            return m_raw;
+        }
+
+        /**
+         * Nearest integer, halves round up.
+         */
+        constexpr int32_t to_int() const noexcept
+        {
+            return static_cast<int32_t>(detail::round_shift(static_cast<int64_t>(m_raw), Frac));
+        }
+
+        /**
+         * Convert to floating point.
+         * 
+         * Intended for tests and logging. This pulls in the floating point
+         * emulation when used in firmware.
+         */
+        constexpr double to_double() const noexcept
+        {
+            return static_cast<double>(m_raw) / static_cast<double>(1ll << Frac);
+        }
+
+        /**
+         * Convert to another format, rounded and saturated.
+         */
+        template <int F, typename U>
+        constexpr fixed<F, U> to() const noexcept
+        {
+            return fixed<F, U>::from_raw(detail::saturate<U>(detail::round_shift(static_cast<int64_t>(m_raw), Frac - F)));
+        }
+
+        constexpr friend fixed operator+(fixed lhs, fixed rhs) noexcept
+        {
+            return from_raw(detail::saturate<T>(static_cast<wide_type>(lhs.m_raw) + rhs.m_raw));
+        }
+
+        constexpr friend fixed operator-(fixed lhs, fixed rhs) noexcept
+        {
+            return from_raw(detail::saturate<T>(static_cast<wide_type>(lhs.m_raw) - rhs.m_raw));
+        }
+
+        constexpr friend fixed operator-(fixed value) noexcept
+        {
+            return from_raw(detail::saturate<T>(-static_cast<wide_type>(value.m_raw)));
+        }
+
+        constexpr friend fixed operator*(fixed lhs, fixed rhs) noexcept
+        {
+            return from_raw(detail::saturate<T>(detail::round_shift(static_cast<wide_type>(lhs.m_raw) * rhs.m_raw, Frac)));
+        }
+
+        /**
+         * Divide, rounded to nearest.
+         * 
+         * Division by zero saturates in the direction of the dividend.
+         */
+        constexpr friend fixed operator/(fixed lhs, fixed rhs) noexcept
+        {
+            if (rhs.m_raw == 0)
+            {
+                return from_raw(lhs.m_raw < 0 ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max());
+            }
+
+            const auto dividend = static_cast<dividend_type>(lhs.m_raw) << Frac;
+            const auto half = static_cast<dividend_type>(rhs.m_raw < 0 ? -rhs.m_raw : rhs.m_raw) / 2;
+
+            // Round half away from zero by biasing the dividend.
+            const auto biased = dividend < 0 ? dividend - half : dividend + half;
+
+            return from_raw(detail::saturate<T>(biased / rhs.m_raw));
+        }
+
+        constexpr fixed &operator+=(fixed rhs) noexcept
+        {
+            return *this = *this + rhs;
+        }
+
+        constexpr fixed &operator-=(fixed rhs) noexcept
+        {
+            return *this = *this - rhs;
+        }
+
+        constexpr fixed &operator*=(fixed rhs) noexcept
+        {
+            return *this = *this * rhs;
+        }
+
+        constexpr friend auto operator<=>(fixed, fixed) noexcept = default;
+        constexpr friend bool operator==(fixed, fixed) noexcept = default;
+    };
+
+    /* Fraction in [-1, 1) with 16-bit storage. */
+    using q15 = fixed<15, int16_t>;
+
+    /* Number in [-32768, 32768) with 16 fractional bits. */
+    using q16 = fixed<16, int32_t>;
+
+    /**
+     * Scale an integer by a fixed-point factor.
+     * 
+     * The product is rounded to nearest and saturated to type R. A
+     * 16-bit value times a 16-bit factor is computed in 32 bits, so
+     * scaling sensor samples takes a single multiply.
+     * 
+     * @param value     Integer value.
+     * @param factor    Scale factor.
+     * @return          Scaled value.
+     */
+    template <typename R, typename V, int F, typename T>
+    constexpr R scale(V value, fixed<F, T> factor) noexcept
+    {
+        static_assert(std::is_integral_v<V>);
+
+        using wide_type = std::conditional_t<sizeof(V) <= sizeof(int16_t) && sizeof(T) <= sizeof(int16_t), int32_t, int64_t>;
+
+        return detail::saturate<R>(detail::round_shift(static_cast<wide_type>(value) * factor.raw(), F));
+    }
+
+    static_assert(q15::from(0.5).raw() == 16384);
+    static_assert(q15::from(-1.0).raw() == -32768);
+    static_assert((q15::from(0.5) * q15::from(0.5)).raw() == 8192);
+    static_assert((q15::from(-0.75) - q15::from(0.75)).raw() == -32768);
+    static_assert((q16::from(3.0) / q16::from(2.0)).to_int() == 2);
+    static_assert((q16::from(-1.0) / q16::from(-3.0)).raw() == 21845);
+    static_assert(q16::from(-2.5).to_int() == -2);
+    static_assert((fixed<22, int16_t>::from(0.007) / fixed<22, int16_t>::from(0.001)).raw() == INT16_MAX);
+    static_assert(scale<int16_t>(int16_t{-3}, q15::from(0.5)) == -1);
+    static_assert(scale<int16_t>(int16_t{32767}, fixed<16, int32_t>::from(2.0)) == 32767);
+} // gleos
@@ -13,6 +13,7 @@
 #include "gleos.h"
 
 #include "hardware/flash.h"
+#include "hardware/sync.h"
 
 #include <cstring>
 
@@ -73,9 +74,15 @@ namespace gleos::flash
         {
             memcpy(buffer.data(), &file, sizeof(file));
 
+            // Code runs from flash, nothing may execute from it while
+            // it is erased and programmed.
+            const auto status = save_and_disable_interrupts();
+
             flash_range_erase(FLASH_FILE_OFFSET + T::offset, FLASH_SECTOR_SIZE);
             flash_range_program(FLASH_FILE_OFFSET + T::offset, buffer.data(), FLASH_PAGE_SIZE);
 
+            restore_interrupts(status);
+
             return true;
         }
 
@@ -57,6 +57,9 @@ namespace gleos
 
     /**
      * Return the time since boot in miliseconds.
+     * 
+     * The value wraps after 49 days. Use `gleos::clock` for
+     * timestamps and scheduling.
      */
     uint32_t ms_since_boot() noexcept;
 
@@ -90,10 +93,14 @@ namespace gleos
     /**
      * Calculate CRC16/IBM_3740 over buffer.
      * 
+     * The checksum can be calculated over multiple buffers by
+     * passing the result of the previous call as initial value.
+     * 
      * @param data      Pointer to buffer data.
      * @param length    Buffer length.
+     * @param crc       Initial checksum value.
      */
-    uint16_t crc16(const uint8_t *data, size_t length);
+    uint16_t crc16(const uint8_t *data, size_t length, uint16_t crc = 0xffff);
 
     /**
      * Convert buffer to signed 16-bit little endian.
@@ -12,6 +12,7 @@
 
 #include "gleos.h"
 #include "driver.h"
+#include "power.h"
 
 #include "hardware/i2c.h"
 
@@ -36,6 +37,13 @@ namespace gleos
 
         private:
             i2c_inst_t *m_instance;
+            mode m_baudrate;
+            power::listener m_listener{retime, this};
+
+            /**
+             * Recompute the bus clock divider on a clock change.
+             */
+            static void retime(power::stage stage, uint32_t sys_hz, void *context);
         };
 
         // TODO: Do something with the errors.
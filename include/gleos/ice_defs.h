@@ -11,9 +11,14 @@
 #pragma once
 
 #include "uart.h"
+#include "packed.h"
+
+#include <iterator>
 
 #define ICE_PROTO_VERSION 5
+#define ICE_PROTO_VERSION_EXTENDED 6
 #define ICE_PACKET_DATA_LEN 8
+#define ICE_PACKET_EXTENDED_PAYLOAD_LEN 64
 
 namespace gleos
 {
@@ -33,9 +38,20 @@ namespace gleos
          */
         enum address_family
         {
+            /* First multicast group address. All addresses from here up to
+               but not including the broadcast address are group addresses. */
+            multicast = 0xff00,
             broadcast = std::numeric_limits<address_type>::max(),
         };
 
+        /**
+         * Check if address is a multicast group address.
+         */
+        inline constexpr bool is_multicast(address_type address) noexcept
+        {
+            return address >= address_family::multicast && address != address_family::broadcast;
+        }
+
         /**
          * Message payload type.
          * 
@@ -57,6 +73,24 @@ namespace gleos
             measurement_angular_velocity_type = 0x14,
             /* Direction type */
             measurement_direction_type = 0x15,
+            /* Acceleration block type */
+            measurement_acceleration_block_type = 0x16,
+            /* Motion block type */
+            measurement_motion_block_type = 0x17,
+            /* Statistics type */
+            statistics_type = 0x18,
+            /* Histogram type */
+            histogram_type = 0x19,
+            /* CPU load type */
+            cpu_load_type = 0x1a,
+            /* Time synchronisation type */
+            time_sync_type = 0x1b,
+            /* Link rate type */
+            link_rate_type = 0x1c,
+            /* Subscription type */
+            subscribe_type = 0x1d,
+            /* Packed acceleration type */
+            measurement_acceleration_packed_type = 0x1e,
         };
 
         enum device_status : uint8_t
@@ -76,25 +110,137 @@ namespace gleos
             payload payload_type;
         };
 
+        /* Offset of the payload in the frame. */
+        constexpr size_t payload_offset = packet::offset + sizeof(packet);
+
+        /* Maximum payload size in bytes. */
+        constexpr size_t payload_size = ICE_PACKET_DATA_LEN - sizeof(packet);
+
+        /**
+         * Maximum payload size of an extended frame in bytes.
+         * 
+         * Extended frames carry ICE_PROTO_VERSION_EXTENDED in the version
+         * field. The packet header is followed by a length byte and the
+         * payload of that length. Devices which only understand the compact
+         * frame will reject extended frames on the version.
+         */
+        constexpr size_t payload_size_max = ICE_PACKET_EXTENDED_PAYLOAD_LEN;
+
+        static_assert(payload_size_max >= payload_size);
+
+        /* Network timestamp in microseconds, the low 32 bits of the network clock. */
+        using timestamp_type = uint32_t;
+
+        /**
+         * Payload type flag of timestamped frames.
+         * 
+         * Any payload can be followed by a network timestamp. The
+         * timestamp is the last field of the payload on the wire and
+         * is not part of the payload structure.
+         */
+        constexpr uint8_t payload_timestamp_flag = 0x80;
+
+        /* Maximum payload length on the wire, including the network timestamp. */
+        constexpr size_t payload_length_max = payload_size_max + sizeof(timestamp_type);
+
+        static_assert(payload_length_max <= std::numeric_limits<uint8_t>::max());
+
+        /**
+         * Link rates in baud.
+         * 
+         * Every link starts at the base rate at index zero. Devices
+         * announce the index of the highest rate they support.
+         */
+        constexpr uint32_t link_rates[] = {115200, 230400, 460800, 921600, 1000000, 2000000, 3000000};
+
+        static_assert(link_rates[0] == GLEOS_DEFAULT_UART_BAUD_RATE);
+
+        /**
+         * Index of the highest link rate up to baud rate.
+         */
+        constexpr uint8_t link_rate_capability(uint32_t baud_rate_max) noexcept
+        {
+            uint8_t index = 0;
+            while (index + 1 < std::size(link_rates) && link_rates[index + 1] <= baud_rate_max)
+            {
+                ++index;
+            }
+
+            return index;
+        }
+
         struct __attribute__((packed)) device_info
         {
             constexpr static size_t offset = packet::offset + sizeof(packet);
+            constexpr static payload type = payload::device_info_type;
 
             address_type address;
             uint8_t version;
             device_status status; // FUTURE: Maybe replace this with u32 uptime.
+            /* Index of the highest supported link rate. */
+            uint8_t capability;
         };
 
         // Payload should never exceed ICE_PACKET_DATA_LEN.
         static_assert(sizeof(device_info) <= ICE_PACKET_DATA_LEN);
 
+        /**
+         * Link rate switch.
+         * 
+         * All devices on the link switch to the rate once the
+         * delay has passed after reception.
+         */
+        struct __attribute__((packed)) link_rate
+        {
+            constexpr static size_t offset = packet::offset + sizeof(packet);
+            constexpr static payload type = payload::link_rate_type;
+
+            /* Index of the link rate. */
+            uint8_t rate;
+            uint16_t delay_ms;
+        };
+
+        // Payload should never exceed ICE_PACKET_DATA_LEN.
+        static_assert(sizeof(link_rate) <= ICE_PACKET_DATA_LEN);
+
+        /**
+         * Measurement subscription.
+         * 
+         * Sent to the publishing device to request a measurement at a
+         * rate. The measurements are sent to the destination, which
+         * can be the address of the subscriber or a multicast group.
+         * The subscription lapses unless it is renewed within its
+         * lifetime. A zero rate cancels the subscription.
+         */
+        struct __attribute__((packed)) subscribe
+        {
+            constexpr static size_t offset = packet::offset + sizeof(packet);
+            constexpr static payload type = payload::subscribe_type;
+
+            /* Payload type of the measurement. */
+            payload measurement;
+            address_type destination;
+            /* Rate in Hz. */
+            uint16_t rate;
+            /* Lifetime in seconds. */
+            uint8_t lifetime;
+        };
+
+        // Payload should never exceed ICE_PACKET_DATA_LEN.
+        static_assert(sizeof(subscribe) <= ICE_PACKET_DATA_LEN);
+
         // FUTURE: Maybe rename this?
         struct __attribute__((packed)) solenoid_control
         {
             constexpr static size_t offset = packet::offset + sizeof(packet);
+            constexpr static payload type = payload::solenoid_control_type;
+
+            /* Validity of the value in miliseconds. Zero selects the device default. */
+            constexpr static uint16_t default_validity = 0;
 
             uint8_t id;
             int16_t value;
+            uint16_t validity_ms;
 
             inline bool is_halt() const noexcept
             {
@@ -139,8 +285,281 @@ namespace gleos
         // Payload should never exceed ICE_PACKET_DATA_LEN.
         static_assert(sizeof(vector3x16) <= ICE_PACKET_DATA_LEN);
 
+        /**
+         * Vector3 sample block.
+         * 
+         * Carries multiple samples of the same measurement in a single
+         * extended frame. Only the first `count` samples are sent.
+         */
+        struct __attribute__((packed)) vector3x16_block
+        {
+            constexpr static size_t offset = packet::offset + sizeof(packet);
+            constexpr static size_t capacity = (payload_size_max - sizeof(uint8_t)) / sizeof(vector3x16);
+
+            uint8_t count;
+            vector3x16 samples[capacity];
+
+            /**
+             * Size of the used part of the block.
+             */
+            inline size_t size() const noexcept
+            {
+                return sizeof(count) + count * sizeof(vector3x16);
+            }
+        };
+
+        // Payload should never exceed ICE_PACKET_EXTENDED_PAYLOAD_LEN.
+        static_assert(sizeof(vector3x16_block) <= ICE_PACKET_EXTENDED_PAYLOAD_LEN);
+
+        /**
+         * Delta encoded vector3 samples.
+         * 
+         * Carries a reference sample and the deltas of the samples
+         * after it in a single extended frame. See `packed.h` for the
+         * layout and the decoder. Only the encoded part is sent.
+         */
+        struct __attribute__((packed)) vector3x16_packed
+        {
+            constexpr static size_t offset = packet::offset + sizeof(packet);
+
+            uint8_t data[payload_size_max];
+
+            /**
+             * Size of the used part of the payload.
+             */
+            inline size_t size() const noexcept
+            {
+                return packed::encoded_size(data);
+            }
+        };
+
+        // Payload should never exceed ICE_PACKET_EXTENDED_PAYLOAD_LEN.
+        static_assert(sizeof(vector3x16_packed) <= ICE_PACKET_EXTENDED_PAYLOAD_LEN);
+
+        /**
+         * Motion sample with acceleration, angular velocity and direction.
+         */
+        struct __attribute__((packed)) motion9x16
+        {
+            vector3x16 acceleration;
+            vector3x16 angular_velocity;
+            vector3x16 direction;
+        };
+
+        /**
+         * Motion sample block.
+         * 
+         * Carries multiple samples of all motion sensors in a single
+         * extended frame. Only the first `count` samples are sent.
+         */
+        struct __attribute__((packed)) motion9x16_block
+        {
+            constexpr static size_t offset = packet::offset + sizeof(packet);
+            constexpr static size_t capacity = (payload_size_max - sizeof(uint8_t)) / sizeof(motion9x16);
+
+            uint8_t count;
+            motion9x16 samples[capacity];
+
+            /**
+             * Size of the used part of the block.
+             */
+            inline size_t size() const noexcept
+            {
+                return sizeof(count) + count * sizeof(motion9x16);
+            }
+        };
+
+        // Payload should never exceed ICE_PACKET_EXTENDED_PAYLOAD_LEN.
+        static_assert(sizeof(motion9x16_block) <= ICE_PACKET_EXTENDED_PAYLOAD_LEN);
+
+        /**
+         * Statistic record.
+         * 
+         * The identifier is the CRC16 of the statistic name. Periods
+         * report their min, avg and max value as separate records.
+         */
+        struct __attribute__((packed)) statistic
+        {
+            enum field_type : uint8_t
+            {
+                current = 0x0,
+                minimum = 0x1,
+                average = 0x2,
+                maximum = 0x3,
+            };
+
+            uint16_t id;
+            field_type field;
+            uint32_t value;
+        };
+
+        /**
+         * Statistics block.
+         * 
+         * The registry does not fit a single frame. Each block carries
+         * the records starting at registry entry `index`. Only the first
+         * `count` records are sent.
+         */
+        struct __attribute__((packed)) statistics
+        {
+            constexpr static size_t offset = packet::offset + sizeof(packet);
+            constexpr static size_t capacity = (payload_size_max - sizeof(uint8_t) * 2) / sizeof(statistic);
+            constexpr static payload type = payload::statistics_type;
+
+            uint8_t index;
+            uint8_t count;
+            statistic records[capacity];
+
+            /**
+             * Size of the used part of the block.
+             */
+            inline size_t size() const noexcept
+            {
+                return sizeof(index) + sizeof(count) + count * sizeof(statistic);
+            }
+        };
+
+        // Payload should never exceed ICE_PACKET_EXTENDED_PAYLOAD_LEN.
+        static_assert(sizeof(statistics) <= ICE_PACKET_EXTENDED_PAYLOAD_LEN);
+
+        /**
+         * Log2 histogram.
+         * 
+         * Bucket `n` counts the samples in [2^n, 2^(n+1)). The first
+         * bucket also counts zero, the last bucket counts everything
+         * beyond. The identifier is the CRC16 of the histogram name.
+         */
+        struct __attribute__((packed)) histogram
+        {
+            constexpr static size_t offset = packet::offset + sizeof(packet);
+            constexpr static size_t bucket_count = 15;
+            constexpr static payload type = payload::histogram_type;
+
+            uint16_t id;
+            uint32_t buckets[bucket_count];
+        };
+
+        // Payload should never exceed ICE_PACKET_EXTENDED_PAYLOAD_LEN.
+        static_assert(sizeof(histogram) <= ICE_PACKET_EXTENDED_PAYLOAD_LEN);
+
+        /**
+         * CPU load record.
+         * 
+         * The identifier is the CRC16 of the task name. The utilisation
+         * is the share of the last window in permille.
+         */
+        struct __attribute__((packed)) cpu_load_record
+        {
+            /* Identifier of the idle time record. */
+            constexpr static uint16_t idle = 0;
+
+            uint16_t id;
+            uint8_t core;
+            uint16_t utilisation;
+        };
+
+        /**
+         * CPU load block.
+         * 
+         * Each block carries the records starting at task `index`. The
+         * first block also carries the idle time of each core. Only the
+         * first `count` records are sent.
+         */
+        struct __attribute__((packed)) cpu_load
+        {
+            constexpr static size_t offset = packet::offset + sizeof(packet);
+            constexpr static size_t capacity = (payload_size_max - sizeof(uint8_t) * 2) / sizeof(cpu_load_record);
+            constexpr static payload type = payload::cpu_load_type;
+
+            uint8_t index;
+            uint8_t count;
+            cpu_load_record records[capacity];
+
+            /**
+             * Size of the used part of the block.
+             */
+            inline size_t size() const noexcept
+            {
+                return sizeof(index) + sizeof(count) + count * sizeof(cpu_load_record);
+            }
+        };
+
+        // Payload should never exceed ICE_PACKET_EXTENDED_PAYLOAD_LEN.
+        static_assert(sizeof(cpu_load) <= ICE_PACKET_EXTENDED_PAYLOAD_LEN);
+
+        /**
+         * Time synchronisation exchange.
+         * 
+         * A node sends a request with its local transmit time `t1`. The
+         * time server answers the origin with `t1`, its network time at
+         * reception `t2` and its network time at transmission `t3`. All
+         * times are in microseconds.
+         */
+        struct __attribute__((packed)) time_sync
+        {
+            constexpr static size_t offset = packet::offset + sizeof(packet);
+            constexpr static payload type = payload::time_sync_type;
+
+            enum stage_type : uint8_t
+            {
+                request = 0x0,
+                response = 0x1,
+            };
+
+            stage_type stage;
+            address_type origin;
+            uint64_t t1;
+            uint64_t t2;
+            uint64_t t3;
+        };
+
+        // Payload should never exceed ICE_PACKET_EXTENDED_PAYLOAD_LEN.
+        static_assert(sizeof(time_sync) <= ICE_PACKET_EXTENDED_PAYLOAD_LEN);
+
+        /**
+         * Typed measurement.
+         * 
+         * Binds a generic payload structure to its payload type so
+         * the type can be deduced at compile time.
+         */
+        template <payload Type, typename T>
+        struct __attribute__((packed)) measurement : T
+        {
+            constexpr static payload type = Type;
+        };
+
+        using temperature = measurement<payload::measurement_temperature_type, scalar16>;
+        using acceleration = measurement<payload::measurement_acceleration_type, vector3x16>;
+        using angular_velocity = measurement<payload::measurement_angular_velocity_type, vector3x16>;
+        using direction = measurement<payload::measurement_direction_type, vector3x16>;
+        using acceleration_block = measurement<payload::measurement_acceleration_block_type, vector3x16_block>;
+        using motion_block = measurement<payload::measurement_motion_block_type, motion9x16_block>;
+        using acceleration_packed = measurement<payload::measurement_acceleration_packed_type, vector3x16_packed>;
+
+        /**
+         * Payload length of object on the wire.
+         * 
+         * Block payloads only send their used part.
+         */
+        template <typename T>
+        inline constexpr size_t payload_length(const T &object) noexcept
+        {
+            if constexpr (requires { object.size(); })
+            {
+                return object.size();
+            }
+            else
+            {
+                return sizeof(T);
+            }
+        }
+
+        /* Size of a compact frame on the wire. */
         constexpr size_t frame_size = packet::offset + ICE_PACKET_DATA_LEN + sizeof(checksum_type);
 
         static_assert(frame_size % 2 == 0);
+
+        /* Maximum size of an extended frame on the wire. */
+        constexpr size_t frame_size_max = payload_offset + sizeof(uint8_t) + payload_length_max + sizeof(checksum_type);
     }
 }
@@ -0,0 +1,125 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos.h"
+#include "fixed.h"
+
+#include <limits>
+
+namespace gleos::interp
+{
+    /**
+     * Scale, offset and saturation of a sample.
+     * 
+     * Computes `clamp((value * factor >> shift) + offset, min, max)`,
+     * rounded to nearest.
+     */
+    struct scaling
+    {
+        int32_t factor;
+        uint8_t shift;
+        /* Offset and rounding, both in units of the product. */
+        int32_t bias;
+        int32_t min;
+        int32_t max;
+    };
+
+    /**
+     * Make a scaling from a fixed-point factor.
+     * 
+     * The product of the sample and the factor plus the offset must
+     * fit in 32 bits. The result saturates to the range of type R.
+     * 
+     * @param factor    Scale factor.
+     * @param offset    Offset added after scaling.
+     */
+    template <typename R, int F, typename T>
+    constexpr scaling make_scaling(fixed<F, T> factor, int32_t offset = 0) noexcept
+    {
+        static_assert(F > 0);
+
+        return scaling{
+            factor : factor.raw(),
+            shift : F,
+            bias : (offset << F) + (1 << (F - 1)),
+            min : std::numeric_limits<R>::min(),
+            max : std::numeric_limits<R>::max(),
+        };
+    }
+
+    /*
+     * The functions below run on the interpolators of the calling
+     * core, each core has its own. Scaling and clamping take
+     * interpolator 1, as only its lane 0 can clamp, lookups take
+     * interpolator 0. They are not reentrant: an interrupt
+     * handler which uses the interpolators must save and restore
+     * them with `interp_save` and `interp_restore`. Host builds use
+     * the software implementation.
+     */
+
+    /**
+     * Scale a block of samples.
+     * 
+     * The interpolator does the shift and saturation in a single
+     * register access, leaving one multiply and one add per sample.
+     * 
+     * @param scaling   Scaling to apply.
+     * @param in        Input samples.
+     * @param out       Output samples, may equal input.
+     * @param count     Number of samples.
+     */
+    void scale(const scaling &scaling, const int16_t *in, int16_t *out, size_t count) noexcept;
+
+    /**
+     * Clamp a block of values to a range.
+     */
+    void clamp(int32_t min, int32_t max, const int32_t *in, int32_t *out, size_t count) noexcept;
+
+    /**
+     * Look up a block of values in a table.
+     * 
+     * The table index is taken from bits `shift` up to `shift + bits`
+     * of each value, which suits the phase of an oscillator or the top
+     * bits of a sample. The interpolator yields the address of the
+     * entry directly.
+     * 
+     * @param table Table of 2^bits entries of 2^size_log2 bytes.
+     * @param bits  Width of the index.
+     * @param shift Position of the index in the value, not
+     *              less than size_log2.
+     */
+    void lookup(const void *table, uint8_t size_log2, uint8_t bits, uint8_t shift, const uint32_t *in, void *out, size_t count) noexcept;
+
+    /**
+     * Look up a block of values in a typed table.
+     */
+    template <typename T>
+    inline void lookup(const T *table, uint8_t bits, uint8_t shift, const uint32_t *in, T *out, size_t count) noexcept
+    {
+        static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4);
+
+        lookup(table, sizeof(T) == 1 ? 0 : sizeof(T) == 2 ? 1 : 2, bits, shift, in, out, count);
+    }
+
+    /**
+     * Software implementation.
+     * 
+     * Same results as the interpolator, used for host builds and as
+     * the reference in the benchmarks.
+     */
+    namespace software
+    {
+        void scale(const scaling &scaling, const int16_t *in, int16_t *out, size_t count) noexcept;
+        void clamp(int32_t min, int32_t max, const int32_t *in, int32_t *out, size_t count) noexcept;
+        void lookup(const void *table, uint8_t size_log2, uint8_t bits, uint8_t shift, const uint32_t *in, void *out, size_t count) noexcept;
+    }
+} // gleos
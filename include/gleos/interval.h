@@ -11,6 +11,8 @@
 #pragma once
 
 #include "gleos.h"
+#include "event.h"
+#include "load.h"
 
 #include "pico/time.h"
 
@@ -19,6 +21,12 @@ namespace gleos
     /**
      * Run method on timer interval.
      * 
+     * The method runs in the timer interrupt unless the timer is
+     * deferred. A deferred timer only marks itself due in the
+     * interrupt, the method runs on the next `run_deferred` from
+     * the main loop. Defer any timer which uses the network link
+     * or other devices shared with the main loop.
+     * 
      * This class can also be extended.
      */
     class timer_interval
@@ -27,6 +35,10 @@ namespace gleos
 
         struct repeating_timer m_timer;
         callback_type m_callback;
+        mutable load::task m_task;
+        const bool m_is_deferred;
+        mutable volatile bool m_is_due{false};
+        timer_interval *m_next{nullptr};
 
         /**
          * This method is invoked on timer trigger.
@@ -35,32 +47,71 @@ namespace gleos
         {
         }
 
+        /**
+         * Run the callback and the invoke method.
+         */
+        void run() const
+        {
+            load::scope scope{m_task};
+            if (m_callback)
+            {
+                m_callback();
+            }
+            invoke();
+        }
+
         /**
          * This callback is invoked on timer trigger.
          */
         static bool timer_interval_callback(struct repeating_timer *timer)
         {
             const auto this_timer = reinterpret_cast<const timer_interval *>(timer->user_data);
-            if (this_timer->m_callback)
+
+            if (this_timer->m_is_deferred)
             {
-                this_timer->m_callback();
+                this_timer->m_is_due = true;
             }
-            this_timer->invoke();
+            else
+            {
+                this_timer->run();
+            }
+
+            event::post(event::timer);
             return true;
         }
 
     public:
         /**
-         * Run method on timer interval.
+         * Context in which the method runs.
          */
-        timer_interval(uint32_t delay_ms, callback_type callback = nullptr)
-            : m_callback{callback}
+        enum class mode
         {
-            if (!add_repeating_timer_ms(delay_ms, timer_interval_callback, this, &m_timer))
-            {
-                // TODO: ...
-                printf("Failed to add timer\n");
-            }
-        }
+            /* In the timer interrupt. */
+            interrupt,
+            /* In the main loop, from `run_deferred`. */
+            deferred,
+        };
+
+        /**
+         * Run method on timer interval.
+         * 
+         * @param delay_ms  Timer interval in miliseconds.
+         * @param callback  Method to run.
+         * @param name      Static name under which the CPU load is accounted.
+         * @param mode      Context in which the method runs.
+         */
+        timer_interval(uint32_t delay_ms, callback_type callback = nullptr, const char *name = "timer", mode mode = mode::interrupt);
+        timer_interval(const timer_interval &) = delete;
+        virtual ~timer_interval();
+
+        /**
+         * Run the deferred timers which are due.
+         * 
+         * Call this from the main loop, at least as often as the
+         * shortest deferred interval. Each timer posts `event::timer`
+         * when it is due, so a main loop can sleep until then. Timers
+         * which were due more than once since the last call run once.
+         */
+        static void run_deferred();
     };
 }
@@ -11,8 +11,16 @@
 #pragma once
 
 #include "uart.h"
+#include "can.h"
 #include "interval.h"
 #include "ice_defs.h"
+#include "stats.h"
+#include "load.h"
+
+#include "pico/sync.h"
+#include "pico/util/queue.h"
+
+#include <cstring>
 
 namespace gleos
 {
@@ -20,7 +28,12 @@ namespace gleos
     {
         class frame
         {
-            std::array<uint8_t, frame_size> m_buffer;
+            // The buffer holds the frame in its compact layout. Extended
+            // payloads continue past the compact payload and are followed
+            // by the checksum. The length byte is not stored.
+            std::array<uint8_t, payload_offset + payload_length_max + sizeof(checksum_type)> m_buffer;
+            size_t m_payload_length{payload_size};
+            uint32_t m_timestamp{0};
 
         public:
             frame();
@@ -38,6 +51,59 @@ namespace gleos
                 return m_buffer.data();
             }
 
+            /**
+             * Payload length in bytes.
+             */
+            inline size_t payload_length() const noexcept
+            {
+                return m_payload_length;
+            }
+
+            /**
+             * Set payload length in bytes.
+             * 
+             * Frames with a payload larger than the compact payload
+             * size are sent as extended frames.
+             * 
+             * @param length    Payload length, at most payload_length_max.
+             */
+            void set_payload_length(size_t length) noexcept;
+
+            /**
+             * Check if frame is sent as extended frame.
+             */
+            inline bool is_extended() const noexcept
+            {
+                return m_payload_length > payload_size;
+            }
+
+            /**
+             * Frame size on the wire.
+             */
+            inline size_t size() const noexcept
+            {
+                return is_extended() ? payload_offset + sizeof(uint8_t) + m_payload_length + sizeof(checksum_type) : frame_size;
+            }
+
+            /**
+             * Receive timestamp.
+             * 
+             * Time in microseconds at which the last byte of the frame
+             * was received. Only meaningful for received frames.
+             */
+            inline uint32_t timestamp() const noexcept
+            {
+                return m_timestamp;
+            }
+
+            /**
+             * Set receive timestamp.
+             */
+            inline void set_timestamp(uint32_t timestamp) noexcept
+            {
+                m_timestamp = timestamp;
+            }
+
             /**
              * Test if frame is valid.
              * 
@@ -53,13 +119,16 @@ namespace gleos
             /**
              * Build a valid frame.
              * 
-             * This will set the magic value and checksum. Frame *must* be
-             * valid after build is called.
+             * This will set the magic value, protocol version and checksum.
+             * Frame *must* be valid after build is called.
              */
             void build();
 
             /**
              * Access object in buffer.
+             * 
+             * Only use this function on packed structures. Prefer `read`
+             * for any other type.
              */
             template <typename T, size_t N = T::offset>
             inline const T *get() const noexcept
@@ -67,13 +136,54 @@ namespace gleos
                 return reinterpret_cast<const T *>(m_buffer.data() + N);
             }
 
+            /**
+             * Copy object from buffer.
+             * 
+             * The object is copied so the read is safe regardless
+             * of the alignment of the object in the buffer.
+             */
+            template <typename T, size_t N = T::offset>
+            inline T read() const noexcept
+            {
+                static_assert(N + sizeof(T) <= std::tuple_size_v<decltype(m_buffer)>);
+
+                T object;
+                std::memcpy(&object, m_buffer.data() + N, sizeof(T));
+                return object;
+            }
+
             /**
              * Set object in buffer.
              */
             template <typename T, size_t N = T::offset>
-            inline void set(T object) noexcept
+            inline void set(const T &object) noexcept
             {
-                (*reinterpret_cast<T *>(m_buffer.data() + N)) = object;
+                static_assert(N + sizeof(T) <= std::tuple_size_v<decltype(m_buffer)>);
+
+                std::memcpy(m_buffer.data() + N, &object, sizeof(T));
+            }
+
+            /**
+             * Set typed payload in buffer.
+             * 
+             * This sets the packet header and payload length
+             * from the payload type.
+             */
+            template <typename T>
+            inline void set_payload(const T &object) noexcept
+            {
+                set(packet{
+                    version : ICE_PROTO_VERSION,
+                    payload_type : T::type,
+                });
+                set_payload_length(ice::payload_length(object));
+                std::memcpy(m_buffer.data() + payload_offset, &object, ice::payload_length(object));
+
+                // Short payloads are padded so no stale data ends up on the wire.
+                if (ice::payload_length(object) < payload_size)
+                {
+                    std::memset(m_buffer.data() + payload_offset + ice::payload_length(object), '\0', payload_size - ice::payload_length(object));
+                }
             }
 
             /**
@@ -83,9 +193,48 @@ namespace gleos
              */
             inline auto address() const noexcept
             {
-                return *get<address_type, sizeof(magic_type)>();
+                return read<address_type, sizeof(magic_type)>();
             }
 
+            /**
+             * Get frame payload type.
+             * 
+             * The timestamp flag is not part of the payload type.
+             */
+            inline auto payload_type() const noexcept
+            {
+                return static_cast<payload>(read<packet>().payload_type & ~payload_timestamp_flag);
+            }
+
+            /**
+             * Check if frame carries a network timestamp.
+             */
+            inline bool has_network_timestamp() const noexcept
+            {
+                return (read<packet>().payload_type & payload_timestamp_flag) && m_payload_length >= payload_size + sizeof(timestamp_type);
+            }
+
+            /**
+             * Network timestamp.
+             * 
+             * Only valid if the frame carries a network timestamp.
+             */
+            inline timestamp_type network_timestamp() const noexcept
+            {
+                timestamp_type timestamp;
+                std::memcpy(&timestamp, m_buffer.data() + payload_offset + m_payload_length - sizeof(timestamp), sizeof(timestamp));
+                return timestamp;
+            }
+
+            /**
+             * Append network timestamp to the payload.
+             * 
+             * Call this after the payload was set.
+             * 
+             * @return True if the timestamp fits the frame, false otherwise.
+             */
+            bool set_network_timestamp(timestamp_type timestamp) noexcept;
+
             /**
              * Check if frame is broadcast message.
              * 
@@ -100,20 +249,632 @@ namespace gleos
             }
         };
 
+        class frame_pool;
+
+        /**
+         * Owning frame handle.
+         * 
+         * The handle refers to a frame in a frame pool. The frame is
+         * returned to the pool when the handle goes out of scope. Handles
+         * can only be moved, so the frame has one owner at any time.
+         */
+        class frame_handle
+        {
+            friend class frame_pool;
+            friend class frame_queue;
+
+            frame_pool *m_pool{nullptr};
+            uint8_t m_slot{0};
+
+            frame_handle(frame_pool *pool, uint8_t slot)
+                : m_pool{pool}, m_slot{slot}
+            {
+            }
+
+        public:
+            frame_handle() = default;
+            frame_handle(const frame_handle &) = delete;
+            frame_handle(frame_handle &&other) noexcept;
+            ~frame_handle();
+
+            frame_handle &operator=(const frame_handle &) = delete;
+            frame_handle &operator=(frame_handle &&other) noexcept;
+
+            /**
+             * Return the frame to the pool.
+             */
+            void reset() noexcept;
+
+            /**
+             * Give up ownership without returning the frame to the pool.
+             * 
+             * The returned slot can be passed to another core or
+             * context and be adopted by the pool again.
+             * 
+             * @return Frame slot in the pool.
+             */
+            uint8_t release() noexcept;
+
+            frame &operator*() const noexcept;
+            frame *operator->() const noexcept;
+
+            /**
+             * Check if the handle owns a frame.
+             */
+            explicit operator bool() const noexcept
+            {
+                return m_pool != nullptr;
+            }
+        };
+
+        /**
+         * Frame pool.
+         * 
+         * Pre-allocated frames which are handed out as owning handles. The
+         * pool can be shared between cores and interrupt handlers.
+         */
+        class frame_pool
+        {
+            friend class frame_handle;
+
+            frame *m_frames;
+            uint8_t m_capacity;
+            uint32_t m_free_mask;
+            critical_section_t m_lock;
+
+            void release(uint8_t slot) noexcept;
+
+        protected:
+            frame_pool(frame *frames, uint8_t capacity);
+            frame_pool(const frame_pool &) = delete;
+            ~frame_pool();
+
+        public:
+            /**
+             * Take a frame from the pool.
+             * 
+             * The frame contents are left as they were.
+             * 
+             * @return Frame handle, which is empty if the pool is exhausted.
+             */
+            frame_handle acquire() noexcept;
+
+            /**
+             * Take ownership of a released frame slot.
+             * 
+             * @param slot  Frame slot as returned by `frame_handle::release`.
+             */
+            frame_handle adopt(uint8_t slot) noexcept;
+
+            /**
+             * Number of frames in the pool.
+             */
+            inline size_t capacity() const noexcept
+            {
+                return m_capacity;
+            }
+
+            /**
+             * Number of available frames.
+             */
+            size_t available() noexcept;
+        };
+
+        /**
+         * Frame pool with a compile time capacity.
+         * 
+         * @tparam N    Number of frames in the pool.
+         */
+        template <size_t N>
+        class static_frame_pool : public frame_pool
+        {
+            static_assert(N > 0 && N <= 32);
+
+            std::array<frame, N> m_storage;
+
+        public:
+            static_frame_pool()
+                : frame_pool{m_storage.data(), N}
+            {
+            }
+        };
+
+        /**
+         * Frame handle queue.
+         * 
+         * Passes frame handles between cores and interrupt handlers
+         * without copying the frames. Only the frame slot is queued.
+         */
+        class frame_queue
+        {
+            frame_pool &m_pool;
+            queue_t m_queue;
+
+        public:
+            /**
+             * Construct frame queue.
+             * 
+             * @param pool      Pool which owns the queued frames.
+             * @param capacity  Maximum number of queued frames.
+             */
+            frame_queue(frame_pool &pool, unsigned int capacity);
+            frame_queue(const frame_queue &) = delete;
+            ~frame_queue();
+
+            /**
+             * Add frame to the queue.
+             * 
+             * The frame stays with the handle if the queue is full.
+             * 
+             * @return True if the frame was queued, false otherwise.
+             */
+            bool push(frame_handle &handle) noexcept;
+
+            /**
+             * Take the next frame from the queue.
+             * 
+             * @return Frame handle, which is empty if the queue is empty.
+             */
+            frame_handle pop() noexcept;
+        };
+
+        /**
+         * Address accept set.
+         * 
+         * A frame is accepted if it is sent to the local address, to the
+         * broadcast address or to one of the joined multicast groups.
+         */
+        class address_filter
+        {
+        public:
+            /* Maximum number of joined multicast groups. */
+            static constexpr size_t group_capacity = 4;
+
+        private:
+            address_type m_address;
+            bool m_accept_broadcast;
+            std::array<address_type, group_capacity> m_groups{};
+            size_t m_group_count{0};
+
+        public:
+            /**
+             * Construct address filter.
+             * 
+             * @param address           Local device address.
+             * @param accept_broadcast  Accept broadcast frames.
+             */
+            constexpr address_filter(address_type address, bool accept_broadcast = true)
+                : m_address{address}, m_accept_broadcast{accept_broadcast}
+            {
+            }
+
+            /**
+             * Join multicast group.
+             * 
+             * @return True if the group was joined, false otherwise.
+             */
+            bool join(address_type group) noexcept;
+
+            /**
+             * Leave multicast group.
+             */
+            void leave(address_type group) noexcept;
+
+            /**
+             * Test if frames to address are accepted.
+             */
+            constexpr bool accepts(address_type address) const noexcept
+            {
+                if (address == m_address)
+                {
+                    return true;
+                }
+                else if (address == address_family::broadcast)
+                {
+                    return m_accept_broadcast;
+                }
+
+                for (size_t i = 0; i < m_group_count; ++i)
+                {
+                    if (m_groups[i] == address)
+                    {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            /**
+             * Local device address.
+             */
+            inline address_type address() const noexcept
+            {
+                return m_address;
+            }
+
+            /**
+             * Check if broadcast frames are accepted.
+             */
+            inline bool accepts_broadcast() const noexcept
+            {
+                return m_accept_broadcast;
+            }
+
+            /**
+             * Joined multicast groups.
+             */
+            inline const address_type *groups() const noexcept
+            {
+                return m_groups.data();
+            }
+
+            /**
+             * Number of joined multicast groups.
+             */
+            inline size_t group_count() const noexcept
+            {
+                return m_group_count;
+            }
+        };
+
+        /**
+         * Link transport interface.
+         * 
+         * A transport moves frames between the network layer and the
+         * physical link. The transport is responsible for any link
+         * specific framing and integrity checks.
+         */
+        class transport
+        {
+        protected:
+            address_filter m_filter{address_family::broadcast};
+            stats::counter m_filtered{"ice.rx.filtered"};
+
+        public:
+            /**
+             * Send frame over the link.
+             * 
+             * The frame must contain an address and a packet.
+             */
+            virtual void send(frame &frame) = 0;
+
+            /**
+             * Receive a frame from the link if one is pending.
+             * 
+             * Frames which fail the link integrity checks or which are
+             * not accepted by the address filter are discarded. The
+             * method does not wait for a frame still on the link.
+             * 
+             * @return True if a valid frame was received, false otherwise.
+             */
+            virtual bool try_receive(frame &frame) = 0;
+
+            /**
+             * Receive the next valid frame from the link.
+             * 
+             * This method blocks until a frame was received.
+             */
+            void receive(frame &frame)
+            {
+                while (!try_receive(frame))
+                {
+                    wait();
+                }
+            }
+
+            /**
+             * Wait for link activity.
+             * 
+             * The default spins. Transports which are woken by the link
+             * sleep instead, until `event::timer` is posted at the
+             * latest. May return without activity on the link.
+             */
+            virtual void wait()
+            {
+                tight_loop_contents();
+            }
+
+            /**
+             * Index of the highest link rate supported by this link.
+             */
+            virtual uint8_t capability() const
+            {
+                return 0;
+            }
+
+            /**
+             * Limit the frames passed by this link to the accept set.
+             * 
+             * @param filter    Address accept set.
+             */
+            virtual void set_address_filter(const address_filter &filter)
+            {
+                m_filter = filter;
+            }
+
+            /**
+             * Number of frames discarded by the address filter.
+             * 
+             * Frames dropped by a hardware filter are not counted.
+             */
+            inline uint32_t filtered_count() const noexcept
+            {
+                return m_filtered.value();
+            }
+        };
+
+        /**
+         * Transport over UART.
+         * 
+         * Each frame is wrapped in a magic value and a checksum. The
+         * receiver scans the byte stream for the magic value. The
+         * transport runs on any serial device, including PIO UARTs.
+         */
+        class uart_transport : public transport
+        {
+            serial &m_device;
+            uint8_t m_capability;
+            uint8_t m_rate{0};
+            size_t m_error_run{0};
+            volatile bool m_is_rate_requested{false};
+            volatile uint8_t m_rate_requested{0};
+            stats::counter m_fallbacks{"ice.link.fallback"};
+
+            // Frame in reception. The bytes of a frame are gathered
+            // over as many receive calls as they take to arrive.
+            frame m_rx_frame;
+            size_t m_rx_position{0};
+            size_t m_rx_end{0};
+
+            /**
+             * Move received bytes into the frame in reception.
+             * 
+             * @param end   Buffer position to fill up to.
+             * @return      True if the position was reached, false if
+             *              the device ran out of data first.
+             */
+            bool receive_until(size_t end);
+
+            /**
+             * Drop the frame in reception.
+             */
+            void restart_receive();
+
+            /**
+             * Apply a requested rate.
+             * 
+             * Only called between frames.
+             */
+            void apply_requested_rate();
+
+            /**
+             * Account a corrupt frame.
+             * 
+             * A run of corrupt frames means the devices on the link
+             * disagree on the rate. Fall back to the base rate.
+             */
+            void link_error();
+
+        public:
+            /**
+             * Construct UART transport instance.
+             * 
+             * The link starts at the base rate.
+             * 
+             * @param device        Device which can read and write data blobs.
+             * @param baud_rate_max Highest baud rate of the transceiver.
+             */
+            uart_transport(serial &device, uint32_t baud_rate_max = GLEOS_ICE_LINK_BAUD_RATE_MAX);
+
+            virtual void send(frame &frame) override;
+            virtual bool try_receive(frame &frame) override;
+            virtual void wait() override;
+
+            virtual uint8_t capability() const override
+            {
+                return m_capability;
+            }
+
+            /**
+             * Index of the current link rate.
+             */
+            inline uint8_t rate() const noexcept
+            {
+                return m_rate;
+            }
+
+            /**
+             * Number of falls back to the base rate.
+             */
+            inline uint32_t fallback_count() const noexcept
+            {
+                return m_fallbacks.value();
+            }
+
+            /**
+             * Switch the link rate.
+             * 
+             * Call between frames, from the context which sends and
+             * receives on the link.
+             * 
+             * @param rate  Index of the link rate.
+             * @return      True if the rate is supported, false otherwise.
+             */
+            bool set_rate(uint8_t rate);
+
+            /**
+             * Switch the link rate at the next frame boundary.
+             * 
+             * The rate is applied by the next send or receive, before
+             * any byte of a frame is moved, so no frame is cut by the
+             * switch. Unlike `set_rate` this method is safe to call
+             * from interrupt handlers.
+             * 
+             * @param rate  Index of the link rate.
+             * @return      True if the rate is supported, false otherwise.
+             */
+            bool request_rate(uint8_t rate) noexcept;
+        };
+
+        /**
+         * Transport over CAN.
+         * 
+         * The address and packet header are mapped onto the 29-bit
+         * extended identifier and the payload is carried in the data
+         * field. The CAN controller provides the integrity checks and
+         * drops misaddressed frames in its acceptance filters.
+         * 
+         * A frame which finds the transmit buffer taken for longer than
+         * GLEOS_ICE_CAN_TX_TIMEOUT_US is dropped, the message holding
+         * the buffer is aborted. A frame with a payload longer than
+         * `can::data_length_max` is dropped as well. Both are counted
+         * in `ice.tx.dropped`.
+         * 
+         * Identifier layout:
+         *  [28..24] Protocol version
+         *  [23..16] Payload type
+         *  [15..0]  Address
+         */
+        class can_transport : public transport
+        {
+            can::controller &m_controller;
+            bool m_is_hardware_filter{false};
+
+        public:
+            /**
+             * Construct CAN transport instance.
+             * 
+             * @param controller    CAN controller.
+             */
+            can_transport(can::controller &controller);
+
+            /**
+             * Encode frame header into an extended identifier.
+             */
+            static constexpr uint32_t make_id(address_type address, payload payload_type, uint8_t version = ICE_PROTO_VERSION)
+            {
+                return (static_cast<uint32_t>(version & 0x1f) << 24) | (static_cast<uint32_t>(payload_type) << 16) | address;
+            }
+
+            virtual void send(frame &frame) override;
+            virtual bool try_receive(frame &frame) override;
+            virtual void set_address_filter(const address_filter &filter) override;
+        };
+
         class layer3
         {
             address_type m_address;
+            address_filter m_filter;
             std::pair<unsigned int, unsigned int> m_version;
-            uart &m_device;
+            transport &m_transport;
+            static_frame_pool<GLEOS_ICE_FRAME_POOL_SIZE> m_pool;
 
         public:
             /**
              * Construct layer instance.
              * 
-             * @param device    Device which can read and write data blobs.
+             * @param transport Link transport which can send and receive frames.
              * @param address   Local device address. 
              */
-            layer3(uart &device, address_type address, std::pair<unsigned int, unsigned int> version);
+            layer3(transport &transport, address_type address, std::pair<unsigned int, unsigned int> version);
+
+            /**
+             * Send payload to address.
+             * 
+             * The payload type is deduced from the payload at compile time.
+             * 
+             * @param address   Recipient address.
+             * @param object    Payload object.
+             */
+            template <typename T>
+            bool send(address_type address, const T &object)
+            {
+                auto frame = m_pool.acquire();
+                if (!frame)
+                {
+                    return false;
+                }
+
+                frame->set_address(address);
+                frame->set_payload(object);
+
+                return send(std::move(frame));
+            }
+
+            /**
+             * Send object with network timestamp.
+             * 
+             * @param address   Recipient address.
+             * @param object    Payload object.
+             * @param timestamp Network timestamp, for example of the sample.
+             * @return          True if the frame was sent, false otherwise.
+             */
+            template <typename T>
+            bool send(address_type address, const T &object, timestamp_type timestamp)
+            {
+                auto frame = m_pool.acquire();
+                if (!frame)
+                {
+                    return false;
+                }
+
+                frame->set_address(address);
+                frame->set_payload(object);
+                if (!frame->set_network_timestamp(timestamp))
+                {
+                    return false;
+                }
+
+                return send(std::move(frame));
+            }
+
+            /**
+             * Send frame.
+             * 
+             * The frame is returned to the pool after transmission.
+             * 
+             * @param frame     Frame handle.
+             */
+            bool send(frame_handle frame);
+
+            /**
+             * Join multicast group.
+             * 
+             * Frames sent to the group address are accepted from now on.
+             * 
+             * @return True if the group was joined, false otherwise.
+             */
+            bool join_group(address_type group);
+
+            /**
+             * Leave multicast group.
+             */
+            void leave_group(address_type group);
+
+            /**
+             * Local device address.
+             */
+            inline address_type address() const noexcept
+            {
+                return m_address;
+            }
+
+            /**
+             * Address filter of this layer.
+             */
+            inline const address_filter &filter() const noexcept
+            {
+                return m_filter;
+            }
+
+            /**
+             * Frame pool used by this layer.
+             */
+            inline frame_pool &pool() noexcept
+            {
+                return m_pool;
+            }
 
             /**
              * Announce this device on the network.
@@ -135,13 +896,169 @@ namespace gleos
              */
             void dispatch_acceleration(address_type address, int16_t x, int16_t y, int16_t z);
 
+            /**
+             * Announce a block of acceleration samples on the network.
+             * 
+             * The block is sent as an extended frame when it does not
+             * fit a compact frame.
+             * 
+             * @param address   Recipient address.
+             * @param block     Acceleration samples.
+             */
+            void dispatch_acceleration(address_type address, const vector3x16_block &block);
+
+            /**
+             * Announce a block of motion samples on the network.
+             * 
+             * @param address   Recipient address.
+             * @param block     Motion samples.
+             */
+            void dispatch_motion(address_type address, const motion9x16_block &block);
+
+            /**
+             * Report the statistics registry on the network.
+             * 
+             * Sends one block of records starting at registry entry `index`.
+             * 
+             * @param address   Recipient address.
+             * @param index     First registry entry.
+             * @return          Index of the next registry entry, or zero
+             *                  when the end of the registry was reached.
+             */
+            size_t dispatch_statistics(address_type address, size_t index = 0);
+
+            /**
+             * Report all histograms in the statistics registry on the network.
+             * 
+             * Each histogram is sent in a separate frame.
+             * 
+             * @param address   Recipient address.
+             */
+            void dispatch_histograms(address_type address);
+
+            /**
+             * Report the CPU load on the network.
+             * 
+             * Sends one block of records starting at task `index`. The
+             * first block also carries the idle time of each core.
+             * 
+             * @param address   Recipient address.
+             * @param window    Closed load window.
+             * @param index     First task.
+             * @return          Index of the next task, or zero when
+             *                  all tasks were reported.
+             */
+            size_t dispatch_load(address_type address, const load::window &window, size_t index = 0);
+
             /**
              * Accept the next application frame.
              * 
              * This method neglects any empty or none usable frames.
              * The returning frame is guaranteed to contain a packet.
+             * The frame is received directly into a pool frame.
+             * Deferred timers run while waiting, see
+             * `timer_interval::run_deferred`.
+             */
+            frame_handle accept();
+
+            /**
+             * Accept the next application frame if one is pending.
+             * 
+             * Unlike `accept` this method returns immediately when no
+             * frame is pending or no frame is free in the pool.
+             * 
+             * @return Frame handle, or an empty handle if no frame was received.
+             */
+            frame_handle try_accept();
+        };
+
+        /**
+         * Payload handler table.
+         * 
+         * Maps each payload type onto its handler. The table layout is
+         * resolved at compile time from the list of payloads so the
+         * dispatch of a frame is a single table lookup.
+         * 
+         * @tparam Ts   Handled payloads.
+         */
+        template <typename... Ts>
+        class dispatcher
+        {
+            using invoke_type = void (*)(const void *context, const frame &frame);
+
+            struct handler
+            {
+                invoke_type invoke{nullptr};
+                const void *context{nullptr};
+            };
+
+            static constexpr uint8_t no_slot = std::numeric_limits<uint8_t>::max();
+
+            static_assert(sizeof...(Ts) < no_slot);
+
+            // Handler slot per payload type.
+            static constexpr auto slots = []
+            {
+                std::array<uint8_t, std::numeric_limits<uint8_t>::max() + 1> slots{};
+                slots.fill(no_slot);
+
+                uint8_t slot = 0;
+                ((slots[Ts::type] = slot++), ...);
+
+                return slots;
+            }();
+
+            static_assert([]
+                          {
+                              uint8_t slot = 0;
+                              return ((slots[Ts::type] == slot++) && ...);
+                          }(),
+                          "Payload types must be unique");
+
+            std::array<handler, sizeof...(Ts)> m_handlers{};
+
+        public:
+            /**
+             * Register handler for payload.
+             * 
+             * The handler is invoked with a copy of the payload. The handler
+             * is referenced, not copied, and must outlive the dispatcher.
+             * 
+             * @param fn    Callable accepting `const T &`.
              */
-            frame accept();
+            template <typename T, typename F>
+            void on(const F &fn) noexcept
+            {
+                static_assert(slots[T::type] != no_slot, "Payload is not handled by this dispatcher");
+
+                m_handlers[slots[T::type]] = handler{
+                    invoke : [](const void *context, const frame &frame)
+                    {
+                        (*static_cast<const F *>(context))(frame.read<T>());
+                    },
+                    context : &fn,
+                };
+            }
+
+            template <typename T, typename F>
+            void on(const F &&fn) = delete;
+
+            /**
+             * Invoke the handler for the frame payload.
+             * 
+             * @return True if a handler was invoked, false otherwise.
+             */
+            bool dispatch(const frame &frame) const
+            {
+                const auto slot = slots[frame.payload_type()];
+                if (slot == no_slot || !m_handlers[slot].invoke)
+                {
+                    return false;
+                }
+
+                m_handlers[slot].invoke(m_handlers[slot].context, frame);
+                return true;
+            }
         };
 
         /**
@@ -150,6 +1067,9 @@ namespace gleos
          * Announce this device on the network. There is no need
          * to do this more than once every second. However it is
          * recommended to broadcast at least *once* every second.
+         * 
+         * The service is deferred to the main loop, like all
+         * services which send on the link.
          */
         class broadcast_service : public timer_interval
         {
@@ -177,5 +1097,79 @@ namespace gleos
              */
             broadcast_service(uint32_t delay_ms, layer3 &layer);
         };
+
+        /**
+         * Statistics service.
+         * 
+         * Broadcast one block of the statistics registry on each
+         * timer interval. The entire registry is reported in turns.
+         * The service is deferred to the main loop.
+         */
+        class statistics_service : public timer_interval
+        {
+            layer3 &m_layer;
+            mutable size_t m_index{0};
+
+            /**
+             * Run the statistics routine.
+             * 
+             * The histograms follow once the registry was reported.
+             */
+            void invoke() const override;
+
+        public:
+            /**
+             * The default interval for statistics messages.
+             * 
+             * This value is in miliseconds.
+             */
+            static const int default_interval = 1000;
+
+        public:
+            /**
+             * Construct statistics service instance.
+             * 
+             * @param delay_ms  Service timer interval in miliseconds.
+             * @param layer     Layer instance. 
+             */
+            statistics_service(uint32_t delay_ms, layer3 &layer);
+        };
+
+        /**
+         * Load service.
+         * 
+         * Broadcast the CPU load of all accounted tasks. The service
+         * has its own load window, which is closed each time all tasks
+         * were reported. The window length follows the interval and
+         * the number of tasks. The service is deferred to the main loop.
+         */
+        class load_service : public timer_interval
+        {
+            layer3 &m_layer;
+            mutable load::window m_window;
+            mutable size_t m_index{0};
+
+            /**
+             * Run the load routine.
+             */
+            void invoke() const override;
+
+        public:
+            /**
+             * The default interval for load messages.
+             * 
+             * This value is in miliseconds.
+             */
+            static const int default_interval = 1000;
+
+        public:
+            /**
+             * Construct load service instance.
+             * 
+             * @param delay_ms  Service timer interval in miliseconds.
+             * @param layer     Layer instance. 
+             */
+            load_service(uint32_t delay_ms, layer3 &layer);
+        };
     }
 }
@@ -0,0 +1,116 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "layer3.h"
+#include "interval.h"
+
+#include "pico/time.h"
+
+namespace gleos::ice
+{
+    /**
+     * Link rate negotiation.
+     * 
+     * A coordinator proposes a link rate to all devices on the link.
+     * Each device, the coordinator included, switches to the rate once
+     * the delay in the proposal has passed, so all devices switch in
+     * lock-step. The transport applies the switch at the next frame
+     * boundary in the main loop. Devices which lose the link at the
+     * new rate fall back to the base rate on a run of corrupt frames.
+     * 
+     * Proposals are clamped to the lowest capability announced on the
+     * link. After a fall back the device announces itself again, so
+     * the coordinator learns its rate. A coordinator which falls back
+     * proposes the next lower rate once the other devices had the time
+     * to fall back as well.
+     */
+    class link_control
+    {
+        layer3 &m_layer;
+        uart_transport &m_transport;
+        alarm_id_t m_alarm{0};
+        volatile uint8_t m_pending{0};
+        uint8_t m_capability_min;
+        uint8_t m_proposed{0};
+        uint8_t m_retry{0};
+        uint8_t m_settle{0};
+        uint32_t m_fallbacks_seen;
+        stats::counter m_switches{"ice.link.switch"};
+        timer_interval m_monitor;
+
+        /**
+         * Switch to the pending rate.
+         */
+        static int64_t switch_callback(alarm_id_t id, void *user_data);
+
+        /**
+         * Switch to rate after delay.
+         */
+        void schedule(uint8_t rate, uint16_t delay_ms);
+
+        /**
+         * Act on a fall back of the transport.
+         */
+        void monitor();
+
+    public:
+        /* Default delay between the proposal and the switch in miliseconds. */
+        constexpr static uint16_t default_delay = 100;
+
+        /* Interval at which the transport is checked for a fall back in miliseconds. */
+        constexpr static uint16_t monitor_interval = 100;
+
+        /* Checks after a fall back before the coordinator proposes again. */
+        constexpr static uint8_t settle_count = 10;
+
+        /**
+         * Construct link control instance.
+         * 
+         * @param layer     Layer instance.
+         * @param transport Link transport of the layer.
+         */
+        link_control(layer3 &layer, uart_transport &transport);
+        link_control(const link_control &) = delete;
+        ~link_control();
+
+        /**
+         * Propose a link rate to all devices on the link.
+         * 
+         * The rate is clamped to `capability_min`.
+         * 
+         * @param rate      Index of the link rate.
+         * @param delay_ms  Delay before the switch.
+         * @return          True if the proposal was sent, false otherwise.
+         */
+        bool propose(uint8_t rate, uint16_t delay_ms = default_delay);
+
+        /**
+         * Process a received link rate proposal.
+         * 
+         * Proposals above the capability of this device are ignored.
+         */
+        void process(const ice::link_rate &message);
+
+        /**
+         * Track the capability of an announced device.
+         */
+        void observe(const ice::device_info &device_info) noexcept;
+
+        /**
+         * Lowest capability of this device and all observed devices.
+         */
+        inline uint8_t capability_min() const noexcept
+        {
+            return m_capability_min;
+        }
+    };
+} // gleos
@@ -0,0 +1,152 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos.h"
+
+namespace gleos::load
+{
+    /* Number of processor cores. */
+    constexpr size_t core_count = 2;
+
+    /**
+     * Accounted task.
+     * 
+     * A task is any unit of work which runs in a `load::scope`, such
+     * as a timer callback, an IRQ handler or the work part of the main
+     * loop. Time on a core not spent in any task is idle time.
+     */
+    class task
+    {
+        friend class scope;
+
+        const char *m_name;
+        uint16_t m_id;
+        uint32_t m_busy[core_count]{};
+
+    public:
+        /**
+         * Construct and register task.
+         * 
+         * @param name  Static task name.
+         */
+        task(const char *name);
+        task(const task &) = delete;
+        ~task();
+
+        inline const char *name() const noexcept
+        {
+            return m_name;
+        }
+
+        /**
+         * Task identifier.
+         * 
+         * The identifier is the CRC16 of the task name.
+         */
+        inline uint16_t id() const noexcept
+        {
+            return m_id;
+        }
+
+        /**
+         * Total busy time on core in microseconds.
+         * 
+         * The Cortex-M0+ has no cycle counter, time is taken from the
+         * 1 MHz system timer which both cores share.
+         */
+        inline uint32_t busy(size_t core) const noexcept
+        {
+            return m_busy[core];
+        }
+    };
+
+    /**
+     * Account the lifetime of this object to a task.
+     * 
+     * Scopes nest. Time spent in a nested scope, for example an IRQ
+     * which preempts a task, is only accounted to the nested task.
+     */
+    class scope
+    {
+        task &m_task;
+        scope *m_parent;
+        uint32_t m_start;
+        uint32_t m_nested{0};
+
+    public:
+        scope(task &task) noexcept;
+        scope(const scope &) = delete;
+        ~scope();
+    };
+
+    /**
+     * Load over a window of time.
+     * 
+     * The window keeps the busy time of each registered task at its
+     * last update. Every consumer of the load has its own window, so
+     * closing one does not cut short the window of another.
+     */
+    class window
+    {
+        struct entry
+        {
+            const task *source;
+            uint32_t busy_last[core_count];
+            uint16_t utilisation[core_count];
+        };
+
+        uint32_t m_start{0};
+        uint16_t m_idle[core_count]{};
+        entry m_entries[GLEOS_LOAD_REGISTRY_SIZE]{};
+
+    public:
+        /**
+         * Close the window.
+         * 
+         * Recompute the utilisation of all tasks and the idle time since
+         * the previous call. Call this at a fixed interval for a rolling
+         * view of the load. Scopes are accounted when they end, so a scope
+         * which is still running is accounted in the next window.
+         */
+        void update() noexcept;
+
+        /**
+         * Idle time of core during the window in permille.
+         */
+        inline uint16_t idle(size_t core) const noexcept
+        {
+            return m_idle[core];
+        }
+
+        /**
+         * Utilisation of core by the task at index in permille.
+         * 
+         * @param index Registry index, see `at`.
+         */
+        inline uint16_t utilisation(size_t index, size_t core) const noexcept
+        {
+            return m_entries[index].utilisation[core];
+        }
+    };
+
+    /**
+     * Number of registered tasks.
+     */
+    size_t count() noexcept;
+
+    /**
+     * Registered task at index.
+     * 
+     * @return Task or nullptr if index is out of range.
+     */
+    const task *at(size_t index) noexcept;
+} // gleos
@@ -13,16 +13,47 @@
 #include "gleos.h"
 #include "pwm.h"
 
+#include "pico/time.h"
+
 namespace gleos
 {
     namespace actuator
     {
         class motor : public pulse_modulation
         {
+            // Shared with the expiry alarm.
+            volatile int32_t m_value{0};
+            volatile int32_t m_ramp_step{0};
+            volatile alarm_id_t m_alarm{0};
+
+            void apply(int32_t value) noexcept;
+
+            static int64_t expire_callback(alarm_id_t id, void *user_data);
+
+        public:
+            /* Number of steps to ramp down an expired motion value. */
+            constexpr static int32_t ramp_steps = 10;
+
+            /* Interval between ramp steps in microseconds. */
+            constexpr static int64_t ramp_interval_us = 10000;
+
         public:
             motor(int port_a, int port_b);
+            motor(const motor &) = delete;
 
-            void set_motion_value(int64_t value) noexcept;
+            /**
+             * Set motion value.
+             * 
+             * When the validity expires the motion value is ramped down
+             * to zero from a hardware alarm. Each new motion value
+             * restarts the validity window. Call from the core which
+             * runs the alarm pool, the update runs with its interrupts
+             * masked.
+             * 
+             * @param value         Signed motion value.
+             * @param validity_ms   Validity in miliseconds, zero never expires.
+             */
+            void set_motion_value(int64_t value, uint32_t validity_ms = 0) noexcept;
         };
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,112 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "fixed.h"
+#include "stats.h"
+
+namespace gleos::ice
+{
+    /**
+     * Disciplined network clock.
+     * 
+     * The network clock runs from the local timer and is corrected
+     * by offset measurements against a time server. Small errors are
+     * slewed out and feed a rate correction, which keeps the clock
+     * close to network time between measurements. Large errors step
+     * the clock. All times are in microseconds.
+     */
+    class network_clock
+    {
+        /* Rate correction as a factor of the elapsed time. */
+        using rate_factor = fixed<30, int32_t>;
+
+        int64_t m_offset{0};
+        uint64_t m_reference{0};
+        int32_t m_rate{0};
+        /* Kept next to the rate, so reading the clock takes no division. */
+        rate_factor m_rate_factor{};
+        uint32_t m_delay_min{0};
+        bool m_is_synchronized{false};
+
+        stats::gauge m_error{"timesync.error"};
+        stats::gauge m_delay{"timesync.delay"};
+        stats::counter m_steps{"timesync.steps"};
+        stats::counter m_rejected{"timesync.rejected"};
+
+    public:
+        /* Errors beyond this bound step the clock. */
+        constexpr static int64_t step_threshold = 1000;
+
+        /* Maximum rate correction in parts per billion. */
+        constexpr static int32_t rate_max = 500000;
+
+        /* Round trip delays beyond twice the minimum plus this margin are outliers. */
+        constexpr static uint32_t delay_margin = 200;
+
+        network_clock() = default;
+        network_clock(const network_clock &) = delete;
+
+        /**
+         * Network time at local time.
+         * 
+         * @param local Local time as returned by `clock::now_us`.
+         */
+        uint64_t at(uint64_t local) const noexcept;
+
+        /**
+         * Current network time.
+         */
+        uint64_t now() const noexcept;
+
+        /**
+         * Expand a network timestamp to the full network time.
+         * 
+         * The timestamp holds the low 32 bits of the network time, as
+         * sent in frames. It is taken to be within 35 minutes of now.
+         */
+        uint64_t expand(uint32_t timestamp) const noexcept;
+
+        /**
+         * Check if the clock follows the network time.
+         */
+        inline bool is_synchronized() const noexcept
+        {
+            return m_is_synchronized;
+        }
+
+        /**
+         * Rate correction in parts per billion.
+         */
+        inline int32_t rate() const noexcept
+        {
+            return m_rate;
+        }
+
+        /**
+         * Make this clock the network time reference.
+         * 
+         * The network time equals the local time from now on.
+         */
+        void set_reference() noexcept;
+
+        /**
+         * Correct the clock from an offset measurement.
+         * 
+         * @param offset    Network time minus local time.
+         * @param delay     Round trip delay of the measurement.
+         * @param local     Local time of the measurement.
+         * @return          True if the measurement was used, false if it was
+         *                  rejected as an outlier.
+         */
+        bool discipline(int64_t offset, uint32_t delay, uint64_t local) noexcept;
+    };
+} // gleos
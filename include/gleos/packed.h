@@ -0,0 +1,318 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+// NOTE: This header is shared with the host side decoder. It must not
+//       depend on the SDK or any other part of gleos.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gleos::packed
+{
+    /*
+     * Delta encoded vector3 samples.
+     * 
+     * Layout, multi-byte fields are little endian:
+     * 
+     *   [0]     Number of samples, including the reference.
+     *   [1..2]  Delta width in bits of x, y and z in bits 0-4, 5-9
+     *           and 10-14.
+     *   [3..8]  Reference sample x, y and z.
+     *   [9..]   Deltas of each following sample to the sample before
+     *           it, for x, y and z in turn. Each delta is taken modulo
+     *           2^16 and zigzag coded into its axis width. The bits
+     *           are packed from the least significant bit of each byte.
+     * 
+     * Slowly changing samples take a few bits per axis instead of 16.
+     */
+
+    constexpr size_t header_size = 9;
+
+    /* Widest delta, the full 16-bit range. */
+    constexpr uint8_t width_max = 16;
+
+    /**
+     * Map a signed value onto an unsigned value with small magnitudes first.
+     */
+    constexpr uint16_t zigzag(int16_t value) noexcept
+    {
+        return static_cast<uint16_t>((static_cast<uint16_t>(value) << 1) ^ (value < 0 ? 0xffff : 0));
+    }
+
+    constexpr int16_t unzigzag(uint16_t value) noexcept
+    {
+        return static_cast<int16_t>((value >> 1) ^ (value & 1 ? 0xffff : 0));
+    }
+
+    /**
+     * Number of bits needed to hold value.
+     */
+    constexpr uint8_t bit_width(uint16_t value) noexcept
+    {
+        uint8_t width = 0;
+        while (value)
+        {
+            ++width;
+            value >>= 1;
+        }
+
+        return width;
+    }
+
+    static_assert(zigzag(0) == 0 && zigzag(-1) == 1 && zigzag(1) == 2 && zigzag(-32768) == 0xffff);
+    static_assert(unzigzag(zigzag(-32768)) == -32768 && unzigzag(zigzag(32767)) == 32767);
+
+    /**
+     * Encoded size of a payload in bytes.
+     * 
+     * @param count     Number of samples, including the reference.
+     * @param widths    Delta width of each axis.
+     */
+    constexpr size_t encoded_size(size_t count, const uint8_t (&widths)[3]) noexcept
+    {
+        if (count == 0)
+        {
+            return header_size;
+        }
+
+        const auto bits = (count - 1) * (widths[0] + widths[1] + widths[2]);
+        return header_size + (bits + 7) / 8;
+    }
+
+    /**
+     * Encoded size of an encoded payload in bytes.
+     */
+    inline size_t encoded_size(const uint8_t *payload) noexcept
+    {
+        const uint16_t field = payload[1] | payload[2] << 8;
+        const uint8_t widths[3] = {
+            static_cast<uint8_t>(field & 0x1f),
+            static_cast<uint8_t>(field >> 5 & 0x1f),
+            static_cast<uint8_t>(field >> 10 & 0x1f),
+        };
+
+        return encoded_size(payload[0], widths);
+    }
+
+    /**
+     * Sample encoder.
+     * 
+     * Collects samples until the next one would not fit the payload,
+     * then encodes them at once. The widths follow the largest delta
+     * of the collected samples.
+     * 
+     * @tparam N    Maximum number of samples in a payload, at most 255.
+     */
+    template <size_t N>
+    class encoder
+    {
+        static_assert(N > 0 && N <= UINT8_MAX);
+
+        int16_t m_samples[N][3];
+        size_t m_count{0};
+        uint8_t m_widths[3]{0, 0, 0};
+        size_t m_payload_size;
+
+    public:
+        /**
+         * Construct encoder instance.
+         * 
+         * @param payload_size  Size of the payload buffer in bytes.
+         */
+        constexpr encoder(size_t payload_size) noexcept
+            : m_payload_size{payload_size}
+        {
+        }
+
+        /**
+         * Number of collected samples.
+         */
+        inline size_t count() const noexcept
+        {
+            return m_count;
+        }
+
+        /**
+         * Add a sample.
+         * 
+         * @return True if the sample was added, false if the payload
+         *         is full. Encode and reset, then add the sample again.
+         */
+        bool add(int16_t x, int16_t y, int16_t z) noexcept
+        {
+            if (m_count == N)
+            {
+                return false;
+            }
+
+            const int16_t sample[] = {x, y, z};
+
+            uint8_t widths[3] = {m_widths[0], m_widths[1], m_widths[2]};
+            if (m_count > 0)
+            {
+                for (size_t i = 0; i < 3; ++i)
+                {
+                    const auto delta = static_cast<int16_t>(sample[i] - m_samples[m_count - 1][i]);
+                    const auto width = bit_width(zigzag(delta));
+
+                    if (width > widths[i])
+                    {
+                        widths[i] = width;
+                    }
+                }
+
+                if (encoded_size(m_count + 1, widths) > m_payload_size)
+                {
+                    return false;
+                }
+            }
+
+            for (size_t i = 0; i < 3; ++i)
+            {
+                m_samples[m_count][i] = sample[i];
+                m_widths[i] = widths[i];
+            }
+
+            ++m_count;
+            return true;
+        }
+
+        /**
+         * Encode the collected samples.
+         * 
+         * @param payload   Payload buffer of the size given on construction.
+         * @return          Encoded size in bytes.
+         */
+        size_t encode(uint8_t *payload) const noexcept
+        {
+            const uint16_t widths = m_widths[0] | m_widths[1] << 5 | m_widths[2] << 10;
+
+            payload[0] = static_cast<uint8_t>(m_count);
+            payload[1] = static_cast<uint8_t>(widths);
+            payload[2] = static_cast<uint8_t>(widths >> 8);
+
+            for (size_t i = 0; i < 3; ++i)
+            {
+                const auto value = static_cast<uint16_t>(m_count ? m_samples[0][i] : 0);
+
+                payload[3 + i * 2] = static_cast<uint8_t>(value);
+                payload[4 + i * 2] = static_cast<uint8_t>(value >> 8);
+            }
+
+            const auto size = encoded_size(m_count, m_widths);
+
+            uint8_t *out = payload + header_size;
+            uint32_t accumulator = 0;
+            uint8_t bits = 0;
+
+            for (size_t n = 1; n < m_count; ++n)
+            {
+                for (size_t i = 0; i < 3; ++i)
+                {
+                    const auto delta = static_cast<int16_t>(m_samples[n][i] - m_samples[n - 1][i]);
+
+                    accumulator |= static_cast<uint32_t>(zigzag(delta)) << bits;
+                    bits += m_widths[i];
+
+                    while (bits >= 8)
+                    {
+                        *out++ = static_cast<uint8_t>(accumulator);
+                        accumulator >>= 8;
+                        bits -= 8;
+                    }
+                }
+            }
+
+            if (bits > 0)
+            {
+                *out++ = static_cast<uint8_t>(accumulator);
+            }
+
+            return size;
+        }
+
+        /**
+         * Drop the collected samples.
+         */
+        void reset() noexcept
+        {
+            m_count = 0;
+            m_widths[0] = m_widths[1] = m_widths[2] = 0;
+        }
+    };
+
+    /**
+     * Decode an encoded payload.
+     * 
+     * @param payload   Encoded payload.
+     * @param length    Length of the payload as received.
+     * @param sample    Callable accepting `int16_t x, int16_t y, int16_t z`,
+     *                  invoked for each sample in order.
+     * @return          Number of decoded samples, or zero if the
+     *                  payload is malformed.
+     */
+    template <typename F>
+    size_t decode(const uint8_t *payload, size_t length, F &&sample)
+    {
+        if (length < header_size)
+        {
+            return 0;
+        }
+
+        const uint16_t field = payload[1] | payload[2] << 8;
+        const uint8_t widths[3] = {
+            static_cast<uint8_t>(field & 0x1f),
+            static_cast<uint8_t>(field >> 5 & 0x1f),
+            static_cast<uint8_t>(field >> 10 & 0x1f),
+        };
+
+        const size_t count = payload[0];
+        if (count == 0 || widths[0] > width_max || widths[1] > width_max || widths[2] > width_max || encoded_size(count, widths) > length)
+        {
+            return 0;
+        }
+
+        int16_t value[3];
+        for (size_t i = 0; i < 3; ++i)
+        {
+            value[i] = static_cast<int16_t>(payload[3 + i * 2] | payload[4 + i * 2] << 8);
+        }
+
+        sample(value[0], value[1], value[2]);
+
+        const uint8_t *in = payload + header_size;
+        uint32_t accumulator = 0;
+        uint8_t bits = 0;
+
+        for (size_t n = 1; n < count; ++n)
+        {
+            for (size_t i = 0; i < 3; ++i)
+            {
+                while (bits < widths[i])
+                {
+                    accumulator |= static_cast<uint32_t>(*in++) << bits;
+                    bits += 8;
+                }
+
+                const auto zigzagged = static_cast<uint16_t>(accumulator & ((1u << widths[i]) - 1));
+                accumulator >>= widths[i];
+                bits -= widths[i];
+
+                value[i] = static_cast<int16_t>(value[i] + unzigzag(zigzagged));
+            }
+
+            sample(value[0], value[1], value[2]);
+        }
+
+        return count;
+    }
+} // gleos
@@ -0,0 +1,144 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos.h"
+#include "event.h"
+#include "power.h"
+#include "serial.h"
+
+#include "hardware/pio.h"
+
+namespace gleos
+{
+    /**
+     * UART on a pair of PIO state machines.
+     * 
+     * Adds serial channels beyond the two hardware UARTs. The receive
+     * FIFO is drained by DMA into a ring buffer and the transmit FIFO
+     * is fed by DMA from a transmit buffer, so the processor does not
+     * handle individual bytes. Supports 8N1 framing up to an eighth of
+     * the system clock.
+     * 
+     * Each instance takes two state machines and three DMA channels.
+     */
+    class pio_uart : public serial
+    {
+        constexpr static size_t rx_buffer_size = 1u << GLEOS_PIO_UART_RX_RING_BITS;
+
+        PIO m_pio;
+        uint m_sm_tx;
+        uint m_sm_rx;
+        uint m_offset_tx;
+        uint m_offset_rx;
+        uint m_dma_tx;
+        uint m_dma_rx;
+        uint m_dma_rx_ctrl;
+        int m_baud_rate;
+        uint32_t m_rx_event;
+
+        // The receive DMA wraps around the ring by address,
+        // the buffer must be aligned to its size.
+        alignas(rx_buffer_size) uint8_t m_rx_buffer[rx_buffer_size];
+        size_t m_rx_tail{0};
+
+        // Reception time of the bytes in the ring when the interrupt
+        // fired, and the number of those bytes not yet read.
+        volatile uint32_t m_rx_stamp{0};
+        volatile size_t m_rx_stamped{0};
+        uint32_t m_rx_timestamp{0};
+
+        uint8_t m_tx_buffer[GLEOS_PIO_UART_TX_BUFFER_SIZE];
+
+        power::listener m_listener{retime, this};
+
+        static void irq_handler();
+
+        /**
+         * Wait until all output has left the line.
+         */
+        void wait_tx_idle() const;
+
+        /**
+         * Apply the baud rate at system clock.
+         */
+        void set_clkdiv(uint32_t sys_hz);
+
+        /**
+         * Recompute the state machine clock divider on a clock change.
+         */
+        static void retime(power::stage stage, uint32_t sys_hz, void *context);
+
+        /**
+         * Position of the receive DMA in the ring buffer.
+         */
+        size_t rx_head() const noexcept;
+
+    public:
+        /**
+         * Construct PIO UART instance.
+         * 
+         * @param pio       PIO block to claim the state machines from.
+         * @param port_tx   Transmit pin.
+         * @param port_rx   Receive pin.
+         * @param baud_rate Baud rate.
+         * @param event     Events to post on reception.
+         */
+        pio_uart(PIO pio, uint port_tx, uint port_rx, int baud_rate = GLEOS_DEFAULT_UART_BAUD_RATE, uint32_t event = event::uart_rx);
+        pio_uart(const pio_uart &) = delete;
+        ~pio_uart();
+
+        bool rx_has_data() const noexcept override;
+
+        /**
+         * Wait for received data.
+         * 
+         * Sleeps until the next reception or any of the events. The
+         * reception interrupt is only armed while waiting, received
+         * bytes do not interrupt the processor otherwise.
+         */
+        void wait_rx(uint32_t events = 0) override;
+
+        bool tx_has_space() const noexcept override;
+
+        void set_baud_rate(int baud_rate) override;
+
+        inline int baud_rate() const noexcept override
+        {
+            return m_baud_rate;
+        }
+
+        void write_putc(char c) override;
+
+        /**
+         * Write data blob.
+         * 
+         * The data is copied into the transmit buffer and sent by DMA.
+         * Returns as soon as the last part of the data was queued.
+         */
+        void write(const uint8_t *buffer, size_t len) override;
+
+        uint8_t read_byte() override;
+        void read(uint8_t *buffer, size_t len) override;
+
+        /**
+         * Receive time of the last byte read.
+         * 
+         * Bytes which arrive while a reader waits are stamped by the
+         * reception interrupt. Other bytes are moved without interrupt
+         * and are stamped when they are read.
+         */
+        inline uint32_t rx_timestamp() const noexcept override
+        {
+            return m_rx_timestamp;
+        }
+    };
+} // gleos
@@ -0,0 +1,92 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos.h"
+
+#include "hardware/vreg.h"
+
+namespace gleos::power
+{
+    /**
+     * Power profile.
+     * 
+     * A profile pairs a system clock frequency with the core
+     * voltage required to run at that frequency.
+     */
+    struct profile
+    {
+        const char *name;
+        uint32_t sys_khz;
+        enum vreg_voltage voltage;
+    };
+
+    /* Idle profile, the lowest clock from which USB can still run. */
+    constexpr profile low{"low", 48000, VREG_VOLTAGE_0_95};
+
+    /* Nominal profile, the default clock after boot. */
+    constexpr profile nominal{"nominal", 125000, VREG_VOLTAGE_1_10};
+
+    /* Overclocked profile for heavy workloads. */
+    constexpr profile high{"high", 200000, VREG_VOLTAGE_1_15};
+
+    enum stage
+    {
+        /* The clock is about to change. Finish any transfer in progress. */
+        prepare,
+        /* The clock has changed. Recompute the clock dividers. */
+        commit,
+    };
+
+    using retime_type = void (*)(stage stage, uint32_t sys_hz, void *context);
+
+    /**
+     * Clock dependent peripheral.
+     * 
+     * Peripherals which derive their timing from the system clock
+     * register a listener. The listener is called on each clock
+     * change, once before and once after the change.
+     */
+    class listener
+    {
+    public:
+        const retime_type retime;
+        void *const context;
+
+        /**
+         * Construct and register listener.
+         * 
+         * @param retime    Retime routine.
+         * @param context   Opaque value passed to the routine.
+         */
+        listener(retime_type retime, void *context);
+        listener(const listener &) = delete;
+        ~listener();
+    };
+
+    /**
+     * Switch to power profile.
+     * 
+     * The voltage is raised before the clock is raised, and lowered
+     * after the clock is lowered. All listeners are retimed with
+     * interrupts disabled, so no interrupt handler observes a
+     * peripheral running from the wrong divider.
+     * 
+     * @return True if the profile was applied, false if the clock
+     *         cannot be derived from the crystal.
+     */
+    bool set_profile(const profile &profile) noexcept;
+
+    /**
+     * Active power profile.
+     */
+    const profile &current() noexcept;
+} // gleos
@@ -11,6 +11,7 @@
 #pragma once
 
 #include "gleos.h"
+#include "power.h"
 
 namespace gleos
 {
@@ -20,6 +21,19 @@ namespace gleos
         bool m_is_enabled = false;
         uint16_t m_chan_a_value = 0;
         uint16_t m_chan_b_value = 0;
+        power::listener m_listener{retime, this};
+
+        /* Counter clock, independent of the system clock. */
+        constexpr static uint32_t counter_frequency = 15625000;
+
+        /**
+         * Recompute the clock divider on a clock change.
+         */
+        static void retime(power::stage stage, uint32_t sys_hz, void *context);
+
+    public:
+        /* Maximum channel value. */
+        constexpr static uint16_t cycle_max = 255;
 
     public:
         /* Create new pulse modulation instance. */
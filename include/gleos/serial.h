@@ -0,0 +1,90 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos.h"
+
+#include <string>
+
+namespace gleos
+{
+    /**
+     * Serial device.
+     * 
+     * Byte stream interface shared by the hardware UARTs and the
+     * PIO UARTs, so links and consoles run on either.
+     */
+    class serial
+    {
+    public:
+        virtual ~serial() = default;
+
+        virtual bool rx_has_data() const noexcept = 0;
+
+        /**
+         * Wait for received data.
+         * 
+         * May return without data, check `rx_has_data`.
+         * 
+         * @param events    Events which end the wait as well. The
+         *                  events are taken when they end the wait.
+         */
+        virtual void wait_rx(uint32_t events = 0) = 0;
+
+        virtual bool tx_has_space() const noexcept = 0;
+
+        /**
+         * Change the baud rate.
+         * 
+         * Pending output is sent at the old rate first.
+         */
+        virtual void set_baud_rate(int baud_rate) = 0;
+
+        virtual int baud_rate() const noexcept = 0;
+
+        virtual void write_putc(char c) = 0;
+        virtual void write(const uint8_t *buffer, size_t len) = 0;
+
+        /**
+         * Keep the line for a transmission of several writes.
+         * 
+         * Half-duplex devices hold the bus from the first write until
+         * `end_transmission`, so the parts of a frame are sent without
+         * turnaround in between. Full-duplex devices ignore this.
+         */
+        virtual void begin_transmission()
+        {
+        }
+
+        /**
+         * Release the line once all output has been sent.
+         */
+        virtual void end_transmission()
+        {
+        }
+
+        virtual uint8_t read_byte() = 0;
+        virtual void read(uint8_t *buffer, size_t len) = 0;
+
+        /**
+         * Receive time of the last byte read.
+         * 
+         * The time is taken as `time_us_32` on reception of the byte,
+         * not when it was read from the device.
+         */
+        virtual uint32_t rx_timestamp() const noexcept = 0;
+
+        inline void operator<<(const std::string &str)
+        {
+            write(reinterpret_cast<const uint8_t *>(str.data()), str.size());
+        }
+    };
+} // gleos
@@ -1,5 +1,5 @@
 /**
- * Microcontroller firmware.
+ * Glonax Embedded Operating System.
  *
  * Copyright (C) 2021 Laixer Equipment B.V.
  * All rights reserved.
@@ -11,20 +11,187 @@
 #pragma once
 
 #include "gleos.h"
-#include "uart.h"
+#include "serial.h"
+
+#include <concepts>
 
 namespace gleos
 {
+    /**
+     * Interactive command shell.
+     * 
+     * The shell never blocks. Call `poll()` regularly, from the main loop
+     * or a timer, to process received bytes and to drain pending output.
+     * Commands are kept in a static registry and can be registered by
+     * any module by declaring a `shell::command` with static storage.
+     */
     class shell
     {
-        uart &m_device;
-
     public:
-        shell(uart &device);
+        /* Maximum length of a command line. */
+        constexpr static size_t line_length = GLEOS_SHELL_LINE_LENGTH;
+
+        /* Maximum number of words on a command line, including the command name. */
+        constexpr static size_t argument_max = 8;
+
+        /**
+         * Buffered output writer.
+         * 
+         * Output is queued in a ring buffer and drained to the device
+         * when the device can accept it. Output which does not fit the
+         * buffer is dropped rather than waiting for the device.
+         */
+        class writer
+        {
+            char m_buffer[GLEOS_SHELL_OUTPUT_BUFFER_SIZE];
+            size_t m_head{0};
+            size_t m_tail{0};
+
+            void write_unsigned(uint64_t value);
+
+        public:
+            /**
+             * Queue data for output.
+             * 
+             * @param data  Data to write.
+             * @param len   Length of the data.
+             */
+            void write(const char *data, size_t len);
+
+            /**
+             * Queue string and pad with spaces up to width.
+             */
+            void write_left(const char *str, size_t width);
+
+            /**
+             * Drain as much output as the device accepts without blocking.
+             */
+            void flush(serial &device);
+
+            /**
+             * Check if there is pending output.
+             */
+            inline bool empty() const noexcept
+            {
+                return m_head == m_tail;
+            }
+
+            writer &operator<<(const char *str);
+            writer &operator<<(char c);
+
+            template <std::integral T>
+            writer &operator<<(T value)
+            {
+                if constexpr (std::is_signed_v<T>)
+                {
+                    if (value < 0)
+                    {
+                        *this << '-';
+                        write_unsigned(0 - static_cast<uint64_t>(value));
+                        return *this;
+                    }
+                }
+
+                write_unsigned(static_cast<uint64_t>(value));
+                return *this;
+            }
+        };
 
-        void read();
+        /**
+         * Command line arguments.
+         * 
+         * The first argument is the command name itself. Arguments
+         * are only valid for the duration of the command handler.
+         */
+        class arguments
+        {
+            friend class shell;
+
+            const char *m_values[argument_max];
+            size_t m_count{0};
+
+        public:
+            inline size_t count() const noexcept
+            {
+                return m_count;
+            }
+
+            /**
+             * Argument at index.
+             * 
+             * @return Argument or an empty string if index is out of range.
+             */
+            inline const char *operator[](size_t index) const noexcept
+            {
+                return index < m_count ? m_values[index] : "";
+            }
+
+            /**
+             * Test if argument at index equals string.
+             */
+            bool is(size_t index, const char *str) const noexcept;
+
+            /**
+             * Parse argument at index as integer.
+             * 
+             * Decimal and hexadecimal (0x prefix) values are accepted.
+             * 
+             * @param index Argument index.
+             * @param value Parsed value.
+             * @return      True if the argument is a valid integer, false otherwise.
+             */
+            bool to_int(size_t index, int32_t &value) const noexcept;
+        };
+
+        using handler_type = void (*)(const arguments &args, writer &out, void *context);
+
+        /**
+         * Shell command.
+         * 
+         * Commands register themselves on construction. The command
+         * strings and context must outlive the command.
+         */
+        class command
+        {
+        public:
+            const char *const name;
+            const char *const usage;
+            const char *const help;
+            const handler_type handler;
+            void *const context;
+
+            /**
+             * Construct and register command.
+             * 
+             * @param name      Command name as typed on the command line.
+             * @param usage     Arguments shown by `help`, may be empty.
+             * @param help      Description shown by `help`.
+             * @param handler   Command handler.
+             * @param context   Opaque value passed to the handler.
+             */
+            command(const char *name, const char *usage, const char *help, handler_type handler, void *context = nullptr);
+            command(const command &) = delete;
+            ~command();
+        };
 
     private:
-        std::string read_command();
+        serial &m_device;
+        writer m_out;
+        char m_line[line_length];
+        size_t m_line_length{0};
+
+        void execute();
+        void prompt();
+
+    public:
+        shell(serial &device);
+
+        /**
+         * Process pending input and output.
+         * 
+         * This method does not block. It reads all bytes received so far
+         * and runs the command once a line is complete.
+         */
+        void poll();
     };
 } // gleos
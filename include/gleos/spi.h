@@ -12,6 +12,7 @@
 
 #include "gleos.h"
 #include "driver.h"
+#include "power.h"
 
 #include "hardware/spi.h"
 
@@ -34,6 +35,13 @@ namespace gleos
         private:
             spi_inst_t *m_instance;
             int m_port_cs;
+            int m_baudrate;
+            power::listener m_listener{retime, this};
+
+            /**
+             * Recompute the serial clock divider on a clock change.
+             */
+            static void retime(power::stage stage, uint32_t sys_hz, void *context);
         };
 
         // TODO: Do something with the errors.
@@ -0,0 +1,286 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos.h"
+
+namespace gleos::stats
+{
+    enum class kind : uint8_t
+    {
+        /* Monotonic event counter. */
+        counter,
+        /* Last set value. */
+        gauge,
+        /* Interval between marks in microseconds. */
+        period,
+        /* Log2 distribution of samples. */
+        histogram,
+    };
+
+    /**
+     * Registry entry.
+     * 
+     * The identifier is derived from the name so it remains the
+     * same across firmware builds.
+     */
+    struct entry
+    {
+        const char *name;
+        uint16_t id;
+        kind type;
+        const void *object;
+    };
+
+    namespace detail
+    {
+        void register_entry(const char *name, kind type, const void *object) noexcept;
+        void unregister_entry(const void *object) noexcept;
+    }
+
+    /**
+     * Event counter.
+     * 
+     * Counters are not atomic. Concurrent updates from both cores
+     * can lose an increment, which is acceptable for telemetry.
+     */
+    class counter
+    {
+        volatile uint32_t m_value{0};
+
+    public:
+        /**
+         * Construct and register counter.
+         * 
+         * @param name  Static counter name.
+         */
+        counter(const char *name)
+        {
+            detail::register_entry(name, kind::counter, this);
+        }
+
+        counter(const counter &) = delete;
+
+        ~counter()
+        {
+            detail::unregister_entry(this);
+        }
+
+        inline void increment(uint32_t count = 1) noexcept
+        {
+            m_value = m_value + count;
+        }
+
+        inline void operator++() noexcept
+        {
+            increment();
+        }
+
+        inline uint32_t value() const noexcept
+        {
+            return m_value;
+        }
+
+        inline void reset() noexcept
+        {
+            m_value = 0;
+        }
+    };
+
+    /**
+     * Gauge.
+     */
+    class gauge
+    {
+        volatile int32_t m_value{0};
+
+    public:
+        /**
+         * Construct and register gauge.
+         * 
+         * @param name  Static gauge name.
+         */
+        gauge(const char *name)
+        {
+            detail::register_entry(name, kind::gauge, this);
+        }
+
+        gauge(const gauge &) = delete;
+
+        ~gauge()
+        {
+            detail::unregister_entry(this);
+        }
+
+        inline void set(int32_t value) noexcept
+        {
+            m_value = value;
+        }
+
+        inline int32_t value() const noexcept
+        {
+            return m_value;
+        }
+    };
+
+    /**
+     * Period between consecutive marks.
+     * 
+     * Tracks the minimum, average and maximum interval in microseconds.
+     * The average is an exponential moving average over roughly the last
+     * 16 intervals, which does not require a division.
+     */
+    class period
+    {
+        uint32_t m_last{0};
+        uint32_t m_min{0};
+        uint32_t m_avg{0};
+        uint32_t m_max{0};
+
+    public:
+        /**
+         * Construct and register period.
+         * 
+         * @param name  Static period name.
+         */
+        period(const char *name)
+        {
+            detail::register_entry(name, kind::period, this);
+        }
+
+        period(const period &) = delete;
+
+        ~period()
+        {
+            detail::unregister_entry(this);
+        }
+
+        /**
+         * Mark the start of the next period.
+         */
+        void mark() noexcept;
+
+        /**
+         * Clear the min and max values.
+         */
+        void reset() noexcept;
+
+        inline uint32_t min() const noexcept
+        {
+            return m_min;
+        }
+
+        inline uint32_t avg() const noexcept
+        {
+            return m_avg;
+        }
+
+        inline uint32_t max() const noexcept
+        {
+            return m_max;
+        }
+    };
+
+    /**
+     * Log2 histogram.
+     * 
+     * Bucket `n` counts the samples in [2^n, 2^(n+1)). The first
+     * bucket also counts zero, the last bucket counts everything
+     * beyond. For latencies in microseconds this covers up to 16ms
+     * in 15 buckets, small enough to keep one per control path.
+     */
+    class histogram
+    {
+    public:
+        constexpr static size_t bucket_count = 15;
+
+    private:
+        uint32_t m_buckets[bucket_count]{};
+
+    public:
+        /**
+         * Construct and register histogram.
+         * 
+         * @param name  Static histogram name.
+         */
+        histogram(const char *name)
+        {
+            detail::register_entry(name, kind::histogram, this);
+        }
+
+        histogram(const histogram &) = delete;
+
+        ~histogram()
+        {
+            detail::unregister_entry(this);
+        }
+
+        /**
+         * Record sample.
+         */
+        inline void record(uint32_t value) noexcept
+        {
+            const size_t bucket = value < 2 ? 0 : 31 - __builtin_clz(value);
+
+            ++m_buckets[bucket < bucket_count ? bucket : bucket_count - 1];
+        }
+
+        /**
+         * Record time elapsed since timestamp in microseconds.
+         * 
+         * @param timestamp Start of the interval from time_us_32.
+         */
+        void record_since(uint32_t timestamp) noexcept;
+
+        /**
+         * Clear all buckets.
+         */
+        void reset() noexcept;
+
+        /**
+         * Total number of samples.
+         */
+        uint32_t total() const noexcept;
+
+        inline uint32_t bucket(size_t index) const noexcept
+        {
+            return m_buckets[index];
+        }
+
+        /**
+         * Lower bound of bucket.
+         */
+        constexpr static uint32_t lower_bound(size_t index) noexcept
+        {
+            return index ? 1u << index : 0;
+        }
+    };
+
+    /**
+     * Number of registered entries.
+     */
+    size_t count() noexcept;
+
+    /**
+     * Number of entries which did not fit the registry.
+     * 
+     * These statistics keep working but cannot be read out. Raise
+     * GLEOS_STATS_REGISTRY_SIZE when this is not zero.
+     */
+    size_t dropped() noexcept;
+
+    /**
+     * Registry entry at index.
+     * 
+     * @return Entry or nullptr if index is out of range.
+     */
+    const entry *at(size_t index) noexcept;
+} // gleos
@@ -0,0 +1,173 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "layer3.h"
+
+namespace gleos::ice
+{
+    /**
+     * Measurement subscription table.
+     * 
+     * The device offers measurements at their source rate. Hosts
+     * subscribe to an offered measurement at a rate up to the source
+     * rate. Each measurement is only sent to its subscribers, every
+     * n-th sample per subscriber, so nothing goes on the link that
+     * nobody asked for. Subscriptions expire unless renewed.
+     * 
+     * Block payloads are decimated by whole blocks. Subscribe to them
+     * at the offered rate for a stream without gaps. Measurements which
+     * are published at irregular times are offered without a rate, each
+     * of their payloads goes to every subscriber.
+     * 
+     * The table is not locked. Process subscriptions and publish
+     * from the same context.
+     */
+    class subscription_table
+    {
+        struct offering
+        {
+            payload measurement;
+            uint16_t rate;
+        };
+
+        struct subscription
+        {
+            payload measurement;
+            address_type destination;
+            uint16_t decimation;
+            /* Samples left until the next one is sent. */
+            uint16_t phase;
+            uint32_t expiry_ms;
+        };
+
+        layer3 &m_layer;
+        std::array<offering, GLEOS_ICE_OFFER_CAPACITY> m_offers{};
+        size_t m_offer_count{0};
+        std::array<subscription, GLEOS_ICE_SUBSCRIPTION_CAPACITY> m_subscriptions{};
+        size_t m_count{0};
+        stats::counter m_expired{"ice.sub.expired"};
+        stats::counter m_rejected{"ice.sub.rejected"};
+
+        /**
+         * Remove the subscriptions which were not renewed in time.
+         */
+        void expire() noexcept;
+
+        /**
+         * Remove subscription at index.
+         */
+        void remove(size_t index) noexcept;
+
+        /**
+         * Advance the subscription by one sample.
+         * 
+         * @return True if the sample is sent, false otherwise.
+         */
+        static bool advance(subscription &entry) noexcept;
+
+        /**
+         * Send to each subscriber of the measurement which is due.
+         */
+        template <typename F>
+        size_t publish_each(payload measurement, const F &send)
+        {
+            expire();
+
+            size_t sent = 0;
+            for (size_t i = 0; i < m_count; ++i)
+            {
+                auto &entry = m_subscriptions[i];
+                if (entry.measurement == measurement && advance(entry) && send(entry.destination))
+                {
+                    ++sent;
+                }
+            }
+
+            return sent;
+        }
+
+    public:
+        /**
+         * Construct subscription table instance.
+         * 
+         * @param layer Layer instance.
+         */
+        subscription_table(layer3 &layer);
+        subscription_table(const subscription_table &) = delete;
+
+        /**
+         * Offer a measurement for subscription.
+         * 
+         * @param measurement   Payload type of the measurement.
+         * @param rate          Rate at which the measurement is published in Hz,
+         *                      or zero if it is published at irregular times.
+         *                      Subscribers then get every payload, regardless
+         *                      of the rate they subscribed at.
+         * @return              True if the offer was added, false otherwise.
+         */
+        bool offer(payload measurement, uint16_t rate) noexcept;
+
+        /**
+         * Process a received subscription.
+         * 
+         * A subscription to a measurement and destination which exists
+         * is renewed, with the new rate and lifetime.
+         * 
+         * @return True if the subscription was accepted, false otherwise.
+         */
+        bool process(const ice::subscribe &message) noexcept;
+
+        /**
+         * Check if the measurement has any subscriber.
+         * 
+         * Use this to skip measurements nobody subscribed to.
+         */
+        bool is_subscribed(payload measurement) noexcept;
+
+        /**
+         * Number of active subscriptions.
+         */
+        inline size_t count() const noexcept
+        {
+            return m_count;
+        }
+
+        /**
+         * Publish a measurement to its subscribers.
+         * 
+         * The payload type is deduced from the payload at compile time.
+         * 
+         * @param object    Payload object.
+         * @return          Number of subscribers the payload was sent to.
+         */
+        template <typename T>
+        size_t publish(const T &object)
+        {
+            return publish_each(T::type, [&](address_type destination)
+                                { return m_layer.send(destination, object); });
+        }
+
+        /**
+         * Publish a measurement with network timestamp to its subscribers.
+         * 
+         * @param object    Payload object.
+         * @param timestamp Network timestamp, for example of the sample.
+         * @return          Number of subscribers the payload was sent to.
+         */
+        template <typename T>
+        size_t publish(const T &object, timestamp_type timestamp)
+        {
+            return publish_each(T::type, [&](address_type destination)
+                                { return m_layer.send(destination, object, timestamp); });
+        }
+    };
+} // gleos
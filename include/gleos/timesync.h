@@ -0,0 +1,109 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "layer3.h"
+#include "interval.h"
+#include "netclock.h"
+
+namespace gleos::ice
+{
+    /* Group address of the network time servers. */
+    constexpr address_type time_server_group = address_family::multicast;
+
+    /**
+     * Two-way time synchronisation.
+     * 
+     * A client sends a request with its local transmit time. The
+     * server answers with its network time at reception and at
+     * transmission. The client computes the offset and round trip
+     * delay from the four times and disciplines its clock. The
+     * offset is exact if the link delay is symmetric.
+     */
+    class clock_sync
+    {
+        layer3 &m_layer;
+        network_clock &m_clock;
+        address_type m_server;
+        bool m_is_server;
+        uint64_t m_pending{0};
+
+    public:
+        /**
+         * Construct time server.
+         * 
+         * The clock becomes the network time reference. The server
+         * joins the time server group.
+         * 
+         * @param layer Layer instance.
+         * @param clock Network clock.
+         */
+        clock_sync(layer3 &layer, network_clock &clock);
+
+        /**
+         * Construct time client.
+         * 
+         * @param layer     Layer instance.
+         * @param clock     Network clock to discipline.
+         * @param server    Address of the time server.
+         */
+        clock_sync(layer3 &layer, network_clock &clock, address_type server);
+
+        /**
+         * Send a synchronisation request to the server.
+         * 
+         * Any unanswered request is abandoned. Servers do not send requests.
+         */
+        void request();
+
+        /**
+         * Process a received synchronisation message.
+         * 
+         * @param message   Synchronisation payload.
+         * @param timestamp Local receive timestamp of the frame.
+         */
+        void process(const ice::time_sync &message, uint32_t timestamp);
+    };
+
+    /**
+     * Time synchronisation service.
+     * 
+     * Send a synchronisation request on each timer interval. The
+     * service is deferred to the main loop, so the request leaves
+     * at the time it is stamped.
+     */
+    class clock_sync_service : public timer_interval
+    {
+        clock_sync &m_sync;
+
+        /**
+         * Run the synchronisation routine.
+         */
+        void invoke() const override;
+
+    public:
+        /**
+         * The default interval for synchronisation requests.
+         * 
+         * This value is in miliseconds.
+         */
+        static const int default_interval = 1000;
+
+    public:
+        /**
+         * Construct time synchronisation service instance.
+         * 
+         * @param delay_ms  Service timer interval in miliseconds.
+         * @param sync      Time client.
+         */
+        clock_sync_service(uint32_t delay_ms, clock_sync &sync);
+    };
+} // gleos
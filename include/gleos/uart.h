@@ -11,25 +11,58 @@
 #pragma once
 
 #include "gleos.h"
+#include "event.h"
+#include "serial.h"
+#include "power.h"
 
 #include "hardware/uart.h"
 
-#include <functional>
-
 namespace gleos
 {
-    class uart
+    class uart : public serial
     {
         uart_inst_t *m_iface;
+        int m_port_rx;
+        int m_baud_rate;
+
+        // Transceiver control in half-duplex mode.
+        int m_port_de{-1};
+        int m_port_re{-1};
+        bool m_is_driving{false};
+        bool m_is_holding{false};
+
+        // Receive buffer filled from the RX interrupt. The
+        // interrupt only moves the head, readers the tail.
+        uint8_t m_rx_buffer[GLEOS_UART_RX_BUFFER_SIZE];
+        uint32_t m_rx_time[GLEOS_UART_RX_BUFFER_SIZE];
+        volatile size_t m_rx_head{0};
+        volatile size_t m_rx_tail{0};
+        uint32_t m_rx_event{0};
+        uint32_t m_rx_timestamp{0};
+
+        power::listener m_listener{retime, this};
 
-        std::function<void(uint8_t *buf, size_t len)> m_on_byte_routine;
+        static void irq_handler();
 
-        uint8_t m_buffer[1024];
-        size_t m_buf_sz{0};
+        /**
+         * Drain the receive FIFO into the receive buffer.
+         */
+        void receive_irq();
 
-        void enable_irq();
+        /**
+         * Recompute the baud rate divider on a clock change.
+         */
+        static void retime(power::stage stage, uint32_t sys_hz, void *context);
 
-        static void irq_handler();
+        /**
+         * Take the bus before transmission.
+         */
+        void drive();
+
+        /**
+         * Release the bus once the last stop bit has been sent.
+         */
+        void release();
 
     public:
         uart(uart_inst_t *iface, int port_tx, int port_rx, int baud_rate = GLEOS_DEFAULT_UART_BAUD_RATE);
@@ -38,24 +71,82 @@ namespace gleos
 
         static void unset(uart_inst_t *iface);
 
-        void on_byte(std::function<void(uint8_t *buf, size_t len)> func)
+        /**
+         * Receive from the RX interrupt.
+         * 
+         * Received bytes are buffered and stamped by the interrupt
+         * handler and the events are posted on each reception. Blocking
+         * reads sleep until data arrives instead of polling the device.
+         * Without the interrupt, bytes are stamped when read.
+         * 
+         * @param event Events to post on reception.
+         */
+        void enable_rx_irq(uint32_t event = event::uart_rx);
+
+        /**
+         * Control an RS-485 transceiver in half-duplex mode.
+         * 
+         * The driver is enabled before the first byte is sent and
+         * disabled as soon as the last stop bit has left the shift
+         * register, which keeps the bus turnaround to a minimum.
+         * Interrupts are masked for at most one character time while
+         * the last character is sent. The receiver is disabled while
+         * driving, so this device does not receive its own output.
+         * 
+         * @param port_de   Driver enable pin, active high.
+         * @param port_re   Receiver enable pin, active low. Pass -1 if the
+         *                  receiver enable is tied to the driver enable.
+         */
+        void set_half_duplex(int port_de, int port_re = -1);
+
+        inline bool is_half_duplex() const noexcept
         {
-            m_on_byte_routine = func;
+            return m_port_de >= 0;
+        }
 
-            enable_irq();
+        inline bool is_rx_irq_enabled() const noexcept
+        {
+            return m_rx_event;
         }
 
-        inline bool rx_has_data() const noexcept
+        inline bool rx_has_data() const noexcept override
         {
-            return uart_is_readable(m_iface);
+            return is_rx_irq_enabled() ? m_rx_head != m_rx_tail : uart_is_readable(m_iface);
         }
 
-        void write_putc(char c);
-        void write(const uint8_t *buffer, size_t len);
+        /**
+         * Wait for received data.
+         * 
+         * Sleeps until the next reception or any of the events when
+         * the RX interrupt is enabled. May return without data, check
+         * `rx_has_data`.
+         */
+        void wait_rx(uint32_t events = 0) override;
+
+        inline bool tx_has_space() const noexcept override
+        {
+            return uart_is_writable(m_iface);
+        }
 
-        uint8_t read_byte();
-        void read(uint8_t *buffer, size_t len);
+        void set_baud_rate(int baud_rate) override;
 
-        void operator<<(const std::string &str);
+        inline int baud_rate() const noexcept override
+        {
+            return m_baud_rate;
+        }
+
+        void write_putc(char c) override;
+        void write(const uint8_t *buffer, size_t len) override;
+
+        void begin_transmission() override;
+        void end_transmission() override;
+
+        uint8_t read_byte() override;
+        void read(uint8_t *buffer, size_t len) override;
+
+        inline uint32_t rx_timestamp() const noexcept override
+        {
+            return m_rx_timestamp;
+        }
     };
 }
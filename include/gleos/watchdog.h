@@ -38,5 +38,98 @@ namespace gleos
          * Watchdog timeout reboot.
          */
         void reboot();
+
+        /**
+         * Supervised task heartbeat.
+         * 
+         * Heartbeats register themselves on construction. Once the
+         * supervisor runs, each heartbeat must beat at least once within
+         * its own timeout or the system is rebooted by the watchdog.
+         */
+        class heartbeat
+        {
+            const char *m_name;
+            uint16_t m_id;
+            uint32_t m_timeout_us;
+            volatile uint32_t m_last;
+
+        public:
+            /**
+             * Construct and register heartbeat.
+             * 
+             * @param name          Static task name.
+             * @param timeout_ms    Maximum time between beats in miliseconds.
+             */
+            heartbeat(const char *name, uint32_t timeout_ms);
+            heartbeat(const heartbeat &) = delete;
+            ~heartbeat();
+
+            /**
+             * Signal the task is alive.
+             */
+            void beat() noexcept;
+
+            /**
+             * Check if the task did beat within its timeout.
+             */
+            bool is_healthy() const noexcept;
+
+            inline const char *name() const noexcept
+            {
+                return m_name;
+            }
+
+            /**
+             * Heartbeat identifier.
+             * 
+             * The identifier is the CRC16 of the task name.
+             */
+            inline uint16_t id() const noexcept
+            {
+                return m_id;
+            }
+        };
+
+        /**
+         * Start the watchdog supervisor.
+         * 
+         * The hardware watchdog is fed from a timer, but only as long as
+         * all registered heartbeats are healthy. The first unhealthy task
+         * is recorded in the watchdog scratch registers before the watchdog
+         * is left to expire. A fault recorded before the last reboot is
+         * reported on the console.
+         * 
+         * @param delay_ms  Hardware watchdog delay in miliseconds.
+         */
+        void supervise(uint32_t delay_ms);
+
+        /**
+         * Supervisor fault record.
+         */
+        struct fault
+        {
+            /* Identifier of the unhealthy heartbeat. */
+            uint16_t id;
+            /* Uptime at the moment of the fault in miliseconds. */
+            uint32_t uptime_ms;
+        };
+
+        /**
+         * Retrieve the fault which caused the last reboot.
+         * 
+         * The record is cleared once read.
+         * 
+         * @param fault Fault record.
+         * @return      True if the last reboot was caused by an unhealthy
+         *              heartbeat, false otherwise.
+         */
+        bool last_fault(fault &fault);
+
+        /**
+         * Find registered heartbeat by identifier.
+         * 
+         * @return Heartbeat or nullptr if not found.
+         */
+        const heartbeat *find(uint16_t id) noexcept;
     };
 }
@@ -0,0 +1,460 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/bench.h"
+#include "gleos/filter.h"
+#include "gleos/fixed.h"
+#include "gleos/interp.h"
+#include "gleos/layer3.h"
+#include "gleos/shell.h"
+
+#include "hardware/clocks.h"
+#include "hardware/pwm.h"
+#include "hardware/sync.h"
+#include "hardware/structs/resets.h"
+#include "hardware/structs/systick.h"
+#include "hardware/structs/xip_ctrl.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+
+using namespace gleos::bench;
+
+// NOTE: The registry is zero initialized before any constructor runs. This
+//       allows cases with static storage in any translation unit to
+//       register themselves.
+static std::array<const benchmark *, GLEOS_BENCH_REGISTRY_SIZE> registry;
+static size_t registry_size;
+
+static std::array<uint32_t, iterations_max> samples;
+
+/* SysTick is a 24-bit down counter. */
+constexpr uint32_t systick_mask = 0xffffff;
+
+benchmark::benchmark(const char *name, routine_type routine, void *context, check_type check)
+    : name{name}, routine{routine}, context{context}, check{check}
+{
+    const auto irq_state = save_and_disable_interrupts();
+
+    // The case is silently lost when the registry is full.
+    if (registry_size < registry.size())
+    {
+        registry[registry_size++] = this;
+    }
+
+    restore_interrupts(irq_state);
+}
+
+benchmark::~benchmark()
+{
+    const auto irq_state = save_and_disable_interrupts();
+
+    for (size_t i = 0; i < registry_size; ++i)
+    {
+        if (registry[i] == this)
+        {
+            // Keep the registration order intact.
+            std::memmove(&registry[i], &registry[i + 1], (registry_size - i - 1) * sizeof(registry[0]));
+            --registry_size;
+            break;
+        }
+    }
+
+    restore_interrupts(irq_state);
+}
+
+/**
+ * Measure a single iteration in cycles.
+ */
+static uint32_t measure(routine_type routine, void *context, uint8_t flags)
+{
+    if (flags & flags::flush_cache)
+    {
+        xip_ctrl_hw->flush = 1;
+        while (!(xip_ctrl_hw->stat & XIP_STAT_FLUSH_READY_BITS))
+        {
+            tight_loop_contents();
+        }
+    }
+
+    uint32_t irq_state = 0;
+    if (flags & flags::mask_interrupts)
+    {
+        irq_state = save_and_disable_interrupts();
+    }
+
+    const uint32_t start = systick_hw->cvr;
+    routine(context);
+    const uint32_t end = systick_hw->cvr;
+
+    if (flags & flags::mask_interrupts)
+    {
+        restore_interrupts(irq_state);
+    }
+
+    return (start - end) & systick_mask;
+}
+
+result gleos::bench::run(const benchmark &benchmark, size_t iterations, uint8_t flags)
+{
+    iterations = std::clamp<size_t>(iterations, 1, iterations_max);
+
+    // Run SysTick freely from the processor clock.
+    systick_hw->rvr = systick_mask;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+
+    // Calibrate the cost of the measurement itself on an empty
+    // routine. The cheapest run is taken as the overhead.
+    uint32_t overhead = systick_mask;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        overhead = std::min(overhead, measure([](void *) {}, nullptr, flags & flags::mask_interrupts));
+    }
+
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        const auto cycles = measure(benchmark.routine, benchmark.context, flags);
+
+        samples[i] = cycles > overhead ? cycles - overhead : 0;
+    }
+
+    std::sort(samples.begin(), samples.begin() + iterations);
+
+    return result{
+        min : samples[0],
+        median : samples[iterations / 2],
+        max : samples[iterations - 1],
+    };
+}
+
+size_t gleos::bench::count() noexcept
+{
+    return registry_size;
+}
+
+const benchmark *gleos::bench::at(size_t index) noexcept
+{
+    if (index >= registry_size)
+    {
+        return nullptr;
+    }
+
+    return registry[index];
+}
+
+//
+// Builtin cases.
+//
+
+static std::array<uint8_t, gleos::ice::payload_size_max> crc_buffer;
+
+static benchmark crc16_case{
+    "crc16",
+    [](void *)
+    {
+        gleos::crc16(crc_buffer.data(), crc_buffer.size());
+    },
+};
+
+static gleos::ice::frame bench_frame;
+
+static benchmark frame_build_case{
+    "frame.build",
+    [](void *)
+    {
+        bench_frame.set_payload(gleos::ice::acceleration{{1, 2, 3}});
+        bench_frame.set_address(gleos::ice::address_family::broadcast);
+        bench_frame.build();
+    },
+};
+
+static benchmark frame_validate_case{
+    "frame.validate",
+    [](void *)
+    {
+        bench_frame.is_valid();
+    },
+};
+
+static benchmark pwm_update_case{
+    "pwm.update",
+    [](void *)
+    {
+        // The block may not be in use by this firmware.
+        if (resets_hw->reset & RESETS_RESET_PWM_BITS)
+        {
+            return;
+        }
+
+        // Write back the current levels so the outputs are left untouched.
+        pwm_hw->slice[0].cc = pwm_hw->slice[0].cc;
+    },
+};
+
+// Compare sensor scaling in fixed-point against the floating point
+// emulation. Volatile operands keep the work from being folded.
+static volatile int16_t scale_sample = -12345;
+static volatile int16_t scale_result;
+
+static benchmark fixed_scale_case{
+    "fixed.scale",
+    [](void *)
+    {
+        scale_result = gleos::scale<int16_t>(scale_sample, gleos::fixed<17, int16_t>::from(0.15));
+    },
+};
+
+static benchmark float_scale_case{
+    "float.scale",
+    [](void *)
+    {
+        scale_result = static_cast<int16_t>(scale_sample * 0.15f);
+    },
+};
+
+// Per block of samples on the interpolator against the software
+// implementation. Divide the cycles by the block size for the cost
+// per sample. The interpolator cases first check their output
+// against the software implementation over a spread of inputs.
+constexpr size_t interp_block_size = 16;
+
+static int16_t interp_samples[interp_block_size];
+static int32_t interp_values[interp_block_size];
+static uint32_t interp_phases[interp_block_size];
+static uint16_t interp_table[256];
+
+constexpr auto interp_scaling = gleos::interp::make_scaling<int16_t>(gleos::q15::from(16000.0 / 32768), 25);
+
+/* Saturates on most of the input range. */
+constexpr auto interp_saturating = gleos::interp::make_scaling<int8_t>(gleos::q15::from(-0.75), -3);
+
+/**
+ * Fill the inputs with a spread over the full range, extremes included.
+ */
+static void interp_fill()
+{
+    for (size_t i = 0; i < interp_block_size; ++i)
+    {
+        const auto step = static_cast<int32_t>(i * 0xffff / (interp_block_size - 1));
+
+        interp_samples[i] = static_cast<int16_t>(step - 0x8000);
+        interp_values[i] = (step - 0x8000) * 3;
+        interp_phases[i] = static_cast<uint32_t>(i) * 0x11111111u;
+    }
+
+    for (size_t i = 0; i < std::size(interp_table); ++i)
+    {
+        interp_table[i] = static_cast<uint16_t>(i * 257);
+    }
+}
+
+static benchmark interp_scale_case{
+    "interp.scale",
+    [](void *)
+    {
+        gleos::interp::scale(interp_scaling, interp_samples, interp_samples, interp_block_size);
+    },
+    nullptr,
+    [](void *)
+    {
+        int16_t expected[interp_block_size], actual[interp_block_size];
+
+        for (const auto &scaling : {interp_scaling, interp_saturating})
+        {
+            interp_fill();
+            gleos::interp::software::scale(scaling, interp_samples, expected, interp_block_size);
+            gleos::interp::scale(scaling, interp_samples, actual, interp_block_size);
+
+            if (!std::equal(std::begin(expected), std::end(expected), actual))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    },
+};
+
+static benchmark soft_scale_case{
+    "soft.scale",
+    [](void *)
+    {
+        gleos::interp::software::scale(interp_scaling, interp_samples, interp_samples, interp_block_size);
+    },
+};
+
+static benchmark interp_clamp_case{
+    "interp.clamp",
+    [](void *)
+    {
+        gleos::interp::clamp(-1000, 1000, interp_values, interp_values, interp_block_size);
+    },
+    nullptr,
+    [](void *)
+    {
+        int32_t expected[interp_block_size], actual[interp_block_size];
+
+        interp_fill();
+        gleos::interp::software::clamp(-1000, 1000, interp_values, expected, interp_block_size);
+        gleos::interp::clamp(-1000, 1000, interp_values, actual, interp_block_size);
+
+        return std::equal(std::begin(expected), std::end(expected), actual);
+    },
+};
+
+static benchmark soft_clamp_case{
+    "soft.clamp",
+    [](void *)
+    {
+        gleos::interp::software::clamp(-1000, 1000, interp_values, interp_values, interp_block_size);
+    },
+};
+
+static benchmark interp_lookup_case{
+    "interp.lookup",
+    [](void *)
+    {
+        gleos::interp::lookup(interp_table, 8, 24, interp_phases, reinterpret_cast<uint16_t *>(interp_samples), interp_block_size);
+    },
+    nullptr,
+    [](void *)
+    {
+        uint16_t expected[interp_block_size], actual[interp_block_size];
+
+        interp_fill();
+        gleos::interp::software::lookup(interp_table, 1, 8, 24, interp_phases, expected, interp_block_size);
+        gleos::interp::lookup(interp_table, 8, 24, interp_phases, actual, interp_block_size);
+
+        return std::equal(std::begin(expected), std::end(expected), actual);
+    },
+};
+
+static benchmark soft_lookup_case{
+    "soft.lookup",
+    [](void *)
+    {
+        gleos::interp::software::lookup(interp_table, 1, 8, 24, interp_phases, interp_samples, interp_block_size);
+    },
+};
+
+// Per block of samples through each filter stage, at the stages
+// used by fw_imu. Divide the cycles by the block size for the cost
+// per input sample.
+constexpr auto filter_biquad_coefficients = gleos::filter::lowpass(40, 1000);
+constexpr auto filter_fir_taps = gleos::filter::cic_compensator<41, 6, 5>(40, 60, 200, 66);
+
+static gleos::filter::biquad filter_biquad{filter_biquad_coefficients};
+static gleos::filter::fir_decimator<41, 2> filter_fir{filter_fir_taps};
+static gleos::filter::cic_decimator<6, 5> filter_cic;
+
+template <typename Stage>
+static void filter_block(Stage &stage)
+{
+    for (size_t i = 0; i < interp_block_size; ++i)
+    {
+        stage.process(interp_samples[i], interp_samples[i]);
+    }
+}
+
+static benchmark filter_biquad_case{
+    "filter.biquad",
+    [](void *)
+    {
+        filter_block(filter_biquad);
+    },
+};
+
+static benchmark filter_fir_case{
+    "filter.fir",
+    [](void *)
+    {
+        filter_block(filter_fir);
+    },
+};
+
+static benchmark filter_cic_case{
+    "filter.cic",
+    [](void *)
+    {
+        filter_block(filter_cic);
+    },
+};
+
+//
+// Shell command.
+//
+
+static gleos::shell::command bench_command{
+    "bench",
+    "[case|all] [n] [noirq] [cold]",
+    "Run on-target benchmarks",
+    [](const gleos::shell::arguments &args, gleos::shell::writer &out, void *)
+    {
+        if (args.count() < 2)
+        {
+            for (size_t i = 0; i < registry_size; ++i)
+            {
+                out << ' ' << registry[i]->name << "\r\n";
+            }
+            return;
+        }
+
+        int32_t iterations = 32;
+        uint8_t flags = flags::none;
+
+        for (size_t i = 2; i < args.count(); ++i)
+        {
+            if (args.is(i, "noirq"))
+            {
+                flags |= flags::mask_interrupts;
+            }
+            else if (args.is(i, "cold"))
+            {
+                flags |= flags::flush_cache;
+            }
+            else if (!args.to_int(i, iterations) || iterations < 1)
+            {
+                out << "usage: bench [case|all] [n] [noirq] [cold]\r\n";
+                return;
+            }
+        }
+
+        const auto is_all = args.is(1, "all");
+        const auto cycles_per_us = clock_get_hz(clk_sys) / 1000000;
+
+        out << ' ';
+        out.write_left("case", 20);
+        out << "min/median/max cycles (@" << cycles_per_us << "MHz)\r\n";
+
+        for (size_t i = 0; i < registry_size; ++i)
+        {
+            if (!is_all && !args.is(1, registry[i]->name))
+            {
+                continue;
+            }
+
+            out << ' ';
+            out.write_left(registry[i]->name, 20);
+
+            if (registry[i]->check && !registry[i]->check(registry[i]->context))
+            {
+                out << "differs from reference\r\n";
+                continue;
+            }
+
+            const auto result = run(*registry[i], iterations, flags);
+
+            out << result.min << "/" << result.median << "/" << result.max << "\r\n";
+        }
+    },
+};
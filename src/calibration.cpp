@@ -0,0 +1,496 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/calibration.h"
+#include "gleos/flash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+using namespace gleos::calibration;
+
+/* Largest spread of a standstill capture per sensor, in the sensor unit.
+ * For the gyroscope 33 counts is 1 dps at the 1000 dps range. */
+static constexpr int32_t standstill_spread[sensor_count] = {50, 33, 0};
+
+/* Smallest field radius of a magnetometer sweep in uT. */
+static constexpr int32_t sweep_radius_min = 10;
+
+static constexpr const char *sensor_names[sensor_count] = {"acc", "gyro", "mag"};
+static constexpr const char *position_names[] = {"+x", "-x", "+y", "-y", "+z", "-z"};
+
+constexpr uint8_t all_positions = 0x3f;
+
+bool correction::is_valid() const noexcept
+{
+    for (const auto &row : matrix)
+    {
+        int32_t sum = 0;
+        for (const auto &element : row)
+        {
+            sum += std::abs(static_cast<int32_t>(element.raw()));
+        }
+
+        if (sum >= 2 * gain::from(1.0).raw())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void correction::apply(int16_t &x, int16_t &y, int16_t &z) const noexcept
+{
+    // The offset is removed first, saturated to 16 bits. With the row
+    // sums below 2 the products then add up within 32 bits.
+    const int32_t vector[] = {
+        detail::saturate<int16_t>(static_cast<int32_t>(x) - offset[0]),
+        detail::saturate<int16_t>(static_cast<int32_t>(y) - offset[1]),
+        detail::saturate<int16_t>(static_cast<int32_t>(z) - offset[2]),
+    };
+
+    int16_t *out[] = {&x, &y, &z};
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        const int32_t sum = matrix[i][0].raw() * vector[0] + matrix[i][1].raw() * vector[1] + matrix[i][2].raw() * vector[2];
+
+        *out[i] = detail::saturate<int16_t>(detail::round_shift(sum, gain::frac_bits));
+    }
+}
+
+void engine::accumulator::reset() noexcept
+{
+    *this = accumulator{
+        sum : {0, 0, 0},
+        min : {INT16_MAX, INT16_MAX, INT16_MAX},
+        max : {INT16_MIN, INT16_MIN, INT16_MIN},
+        count : 0,
+    };
+}
+
+void engine::accumulator::add(int16_t x, int16_t y, int16_t z) noexcept
+{
+    const int16_t vector[] = {x, y, z};
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        min[i] = std::min(min[i], vector[i]);
+        max[i] = std::max(max[i], vector[i]);
+    }
+
+    // A sweep can run for any time, only the extremes are kept then.
+    if (count < sample_count)
+    {
+        for (size_t i = 0; i < 3; ++i)
+        {
+            sum[i] += vector[i];
+        }
+
+        ++count;
+    }
+}
+
+int16_t engine::accumulator::mean(size_t axis) const noexcept
+{
+    if (!count)
+    {
+        return 0;
+    }
+
+    const auto half = sum[axis] < 0 ? -(count / 2) : count / 2;
+
+    return static_cast<int16_t>((sum[axis] + half) / count);
+}
+
+int32_t engine::accumulator::spread() const noexcept
+{
+    int32_t spread = 0;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        spread = std::max(spread, static_cast<int32_t>(max[i]) - min[i]);
+    }
+
+    return spread;
+}
+
+engine::engine()
+    : m_command{
+          "calibrate",
+          "[acc <+x|-x|+y|-y|+z|-z>|gyro|mag [stop]|save|reset|abort]",
+          "Calibrate the motion sensors",
+          command,
+          this,
+      }
+{
+    for (auto &correction : m_corrections)
+    {
+        correction = correction::identity();
+    }
+
+    if (flash::has_file<file>())
+    {
+        const auto stored = flash::open_file<file>();
+
+        for (size_t i = 0; i < sensor_count; ++i)
+        {
+            if (stored.corrections[i].is_valid())
+            {
+                m_corrections[i] = stored.corrections[i];
+            }
+        }
+    }
+}
+
+void engine::begin(sensor target, state mode)
+{
+    // Abandon any running capture first.
+    if (m_state != state::idle)
+    {
+        end("aborted", false);
+    }
+
+    m_sensor = target;
+    m_state = mode;
+    m_result = nullptr;
+    m_accumulator.reset();
+
+    // Capture the sensor as it is, without the current correction.
+    m_saved = m_corrections[target];
+    m_corrections[target] = correction::identity();
+}
+
+void engine::end(const char *result, bool is_fitted)
+{
+    if (!is_fitted)
+    {
+        m_corrections[m_sensor] = m_saved;
+    }
+
+    m_state = state::idle;
+    m_result = result;
+}
+
+void engine::feed(sensor source, int16_t x, int16_t y, int16_t z) noexcept
+{
+    if (!is_capturing(source))
+    {
+        return;
+    }
+
+    m_accumulator.add(x, y, z);
+
+    if (m_state == state::capture && m_accumulator.count == sample_count)
+    {
+        finish();
+    }
+}
+
+void engine::finish()
+{
+    if (m_state == state::sweep)
+    {
+        const auto is_fitted = fit_magnetometer();
+
+        end(is_fitted ? "fitted" : "sweep too small", is_fitted);
+        return;
+    }
+
+    if (m_accumulator.spread() > standstill_spread[m_sensor])
+    {
+        end("not at standstill", false);
+        return;
+    }
+
+    if (m_sensor == gyroscope)
+    {
+        // Keep the scale, only the bias is captured.
+        auto correction = m_saved;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            correction.offset[i] = m_accumulator.mean(i);
+        }
+
+        m_corrections[gyroscope] = correction;
+        end("fitted", true);
+        return;
+    }
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        m_means[m_position][i] = m_accumulator.mean(i);
+    }
+
+    m_positions |= 1 << m_position;
+
+    if (m_positions != all_positions)
+    {
+        end("position captured", false);
+        return;
+    }
+
+    m_positions = 0;
+
+    const auto is_fitted = fit_accelerometer();
+
+    end(is_fitted ? "fitted" : "positions inconsistent", is_fitted);
+}
+
+bool engine::fit_accelerometer()
+{
+    // Each axis pointing up and down gives the response to gravity on
+    // that axis, free of offset. These columns form the sensor matrix
+    // D, the correction is the inverse scaled to gravity. This runs
+    // once per calibration, so floating point is fine here.
+    float d[3][3];
+    float offset[3];
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        offset[i] = 0;
+        for (size_t p = 0; p < 6; ++p)
+        {
+            offset[i] += m_means[p][i];
+        }
+        offset[i] /= 6;
+
+        for (size_t j = 0; j < 3; ++j)
+        {
+            d[i][j] = (m_means[2 * j][i] - m_means[2 * j + 1][i]) / 2.0f;
+        }
+    }
+
+    // The axis pointing up must see most of gravity.
+    for (size_t j = 0; j < 3; ++j)
+    {
+        if (d[j][j] < gravity / 2)
+        {
+            return false;
+        }
+    }
+
+    const float det = d[0][0] * (d[1][1] * d[2][2] - d[1][2] * d[2][1]) -
+                      d[0][1] * (d[1][0] * d[2][2] - d[1][2] * d[2][0]) +
+                      d[0][2] * (d[1][0] * d[2][1] - d[1][1] * d[2][0]);
+
+    if (std::fabs(det) < 1.0f)
+    {
+        return false;
+    }
+
+    // Inverse by the adjugate.
+    const float inverse[3][3] = {
+        {d[1][1] * d[2][2] - d[1][2] * d[2][1], d[0][2] * d[2][1] - d[0][1] * d[2][2], d[0][1] * d[1][2] - d[0][2] * d[1][1]},
+        {d[1][2] * d[2][0] - d[1][0] * d[2][2], d[0][0] * d[2][2] - d[0][2] * d[2][0], d[0][2] * d[1][0] - d[0][0] * d[1][2]},
+        {d[1][0] * d[2][1] - d[1][1] * d[2][0], d[0][1] * d[2][0] - d[0][0] * d[2][1], d[0][0] * d[1][1] - d[0][1] * d[1][0]},
+    };
+
+    correction fitted{};
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        fitted.offset[i] = static_cast<int16_t>(std::lround(offset[i]));
+
+        for (size_t j = 0; j < 3; ++j)
+        {
+            const auto element = std::lround(inverse[i][j] / det * gravity * (1 << gain::frac_bits));
+            if (element < INT16_MIN || element > INT16_MAX)
+            {
+                return false;
+            }
+
+            fitted.matrix[i][j] = gain::from_raw(static_cast<int16_t>(element));
+        }
+    }
+
+    if (!fitted.is_valid())
+    {
+        return false;
+    }
+
+    m_corrections[accelerometer] = fitted;
+
+    return true;
+}
+
+bool engine::fit_magnetometer()
+{
+    int32_t radius[3];
+    int32_t radius_sum = 0;
+
+    correction fitted = correction::identity();
+
+    // The extremes of each axis span the field sphere, distorted into
+    // an ellipsoid by soft iron and moved off center by hard iron.
+    for (size_t i = 0; i < 3; ++i)
+    {
+        radius[i] = (static_cast<int32_t>(m_accumulator.max[i]) - m_accumulator.min[i]) / 2;
+        if (radius[i] < sweep_radius_min)
+        {
+            return false;
+        }
+
+        radius_sum += radius[i];
+        fitted.offset[i] = static_cast<int16_t>((static_cast<int32_t>(m_accumulator.max[i]) + m_accumulator.min[i]) / 2);
+    }
+
+    // Scale each axis to the mean radius.
+    for (size_t i = 0; i < 3; ++i)
+    {
+        const auto element = ((radius_sum << gain::frac_bits) / 3 + radius[i] / 2) / radius[i];
+
+        fitted.matrix[i][i] = gain::from_raw(detail::saturate<int16_t>(element));
+    }
+
+    if (!fitted.is_valid())
+    {
+        return false;
+    }
+
+    m_corrections[magnetometer] = fitted;
+
+    return true;
+}
+
+bool engine::save()
+{
+    file stored;
+
+    std::copy(std::begin(m_corrections), std::end(m_corrections), std::begin(stored.corrections));
+
+    // Never store a correction from the middle of a capture.
+    if (m_state != state::idle)
+    {
+        stored.corrections[m_sensor] = m_saved;
+    }
+
+    return flash::save_file(stored);
+}
+
+void engine::command(const shell::arguments &args, shell::writer &out, void *context)
+{
+    auto self = static_cast<engine *>(context);
+
+    if (args.is(1, "acc"))
+    {
+        size_t index = 0;
+        while (index < std::size(position_names) && !args.is(2, position_names[index]))
+        {
+            ++index;
+        }
+
+        if (index == std::size(position_names))
+        {
+            out << "usage: calibrate acc <+x|-x|+y|-y|+z|-z>\r\n";
+            return;
+        }
+
+        self->begin(accelerometer, state::capture);
+        self->m_position = static_cast<position>(index);
+    }
+    else if (args.is(1, "gyro"))
+    {
+        self->begin(gyroscope, state::capture);
+    }
+    else if (args.is(1, "mag"))
+    {
+        if (args.is(2, "stop"))
+        {
+            if (self->is_capturing(magnetometer))
+            {
+                self->finish();
+            }
+        }
+        else
+        {
+            self->begin(magnetometer, state::sweep);
+        }
+    }
+    else if (args.is(1, "save"))
+    {
+        out << (self->save() ? "Saved\r\n" : "calibrate: save failed\r\n");
+        return;
+    }
+    else if (args.is(1, "reset"))
+    {
+        if (self->m_state != state::idle)
+        {
+            self->end("aborted", false);
+        }
+
+        self->m_positions = 0;
+        for (auto &correction : self->m_corrections)
+        {
+            correction = correction::identity();
+        }
+    }
+    else if (args.is(1, "abort"))
+    {
+        if (self->m_state != state::idle)
+        {
+            self->end("aborted", false);
+        }
+    }
+    else if (args.count() > 1)
+    {
+        out << "usage: calibrate [acc <+x|-x|+y|-y|+z|-z>|gyro|mag [stop]|save|reset|abort]\r\n";
+        return;
+    }
+
+    if (self->m_state != state::idle)
+    {
+        out << "Capture: " << sensor_names[self->m_sensor];
+        if (self->m_sensor == accelerometer)
+        {
+            out << ' ' << position_names[self->m_position];
+        }
+        if (self->m_state == state::sweep)
+        {
+            out << " (turn in all directions, then 'calibrate mag stop')\r\n";
+        }
+        else
+        {
+            out << ' ' << self->m_accumulator.count << "/" << sample_count << "\r\n";
+        }
+    }
+    else if (self->m_result)
+    {
+        out << "Result: " << self->m_result << "\r\n";
+    }
+
+    if (self->m_positions)
+    {
+        out << "Positions:";
+        for (size_t p = 0; p < std::size(position_names); ++p)
+        {
+            if (self->m_positions & (1 << p))
+            {
+                out << ' ' << position_names[p];
+            }
+        }
+        out << "\r\n";
+    }
+
+    for (size_t i = 0; i < sensor_count; ++i)
+    {
+        const auto &correction = self->m_corrections[i];
+
+        out << ' ';
+        out.write_left(sensor_names[i], 6);
+        out << "offset " << correction.offset[0] << " " << correction.offset[1] << " " << correction.offset[2] << " matrix(Q14)";
+        for (const auto &row : correction.matrix)
+        {
+            out << " " << row[0].raw() << " " << row[1].raw() << " " << row[2].raw() << ";";
+        }
+        out << "\r\n";
+    }
+}
@@ -9,9 +9,11 @@
  */
 
 #include "gleos/gleos.h"
+#include "gleos/clock.h"
 #include "gleos/uart.h"
 #include "gleos/watchdog.h"
 #include "gleos/flash.h"
+#include "gleos/power.h"
 
 #include "pico/stdlib.h"
 #include "pico/stdio_uart.h"
@@ -25,6 +27,29 @@ namespace gleos
 {
     uint16_t device_id = 0x2500;
 
+    static bool is_console_enabled = false;
+
+    // The console port has no driver instance, so retime it here.
+    static power::listener console_listener{
+        [](power::stage stage, uint32_t, void *)
+        {
+            if (!is_console_enabled)
+            {
+                return;
+            }
+
+            if (stage == power::prepare)
+            {
+                uart_tx_wait_blocking(uart0);
+            }
+            else
+            {
+                uart_set_baudrate(uart0, GLEOS_DEFAULT_UART_BAUD_RATE);
+            }
+        },
+        nullptr,
+    };
+
     namespace detail
     {
         struct device_config
@@ -66,12 +91,12 @@ namespace gleos
 
     uint32_t sec_since_boot() noexcept
     {
-        return to_ms_since_boot(get_absolute_time()) / 1000;
+        return static_cast<uint32_t>(to_seconds(clock::now().time_since_epoch()));
     }
 
     uint32_t ms_since_boot() noexcept
     {
-        return to_ms_since_boot(get_absolute_time());
+        return static_cast<uint32_t>(to_ms(clock::now().time_since_epoch()));
     }
 
     void reboot(boot_mode mode) noexcept
@@ -108,13 +133,14 @@ namespace gleos
         // NOTE: The console port claims the hardware UART device, which cannnot
         //       be allocated again.
         stdio_uart_init_full(uart0, GLEOS_DEFAULT_UART_BAUD_RATE, GLEOS_STDIO_TX_PIN, GLEOS_STDIO_RX_PIN);
+
+        is_console_enabled = true;
     }
 
     // FUTURE: CRC should not be calculated in software.
-    uint16_t crc16(const uint8_t *data, size_t length)
+    uint16_t crc16(const uint8_t *data, size_t length, uint16_t crc)
     {
         uint8_t tmp = 0;
-        uint16_t crc = 0xffff;
 
         while (length--)
         {
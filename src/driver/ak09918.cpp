@@ -10,6 +10,9 @@
 
 #include "ak09918.h"
 
+#include "gleos/event.h"
+#include "gleos/fixed.h"
+
 #define I2C_ADDRESS 0x0c
 #define WIA_VENDOR 0x48
 
@@ -37,8 +40,8 @@
 
 // NOTE: Even though this device supports fast mode it looks like
 //       standard mode has better performance.
-ak09918::ak09918(gleos::i2c::block &block)
-    : gleos::i2c::driver{block, I2C_ADDRESS}
+ak09918::ak09918(gleos::i2c::block &block, uint32_t data_ready)
+    : gleos::i2c::driver{block, I2C_ADDRESS}, m_data_ready{data_ready}
 {
     set_operation_mode(operation_mode::continuous_100hz);
 }
@@ -77,9 +80,11 @@ void ak09918::read_mag_vector3(int16_t &x, int16_t &y, int16_t &z)
         m_i2c.read_register(AK09918_ST1, buffer, sizeof(buffer));
 
         // If the measurement was not yet ready to set the shift
-        // register then spend another cycle and check again.
+        // register then sleep until the data ready line fires, or
+        // until the next poll when the line is not bound.
         if (!(buffer[0] & AK09918_DRDY_BIT))
         {
+            gleos::event::wait(m_data_ready, std::chrono::milliseconds{1});
             continue;
         }
 
@@ -94,9 +99,15 @@ void ak09918::read_mag_vector3(int16_t &x, int16_t &y, int16_t &z)
         }
 
         // Calculate the magnetic flux density from the signed 16-bit normal.
-        x = (axis_x * 15) / 100;
-        y = (axis_y * 15) / 100;
-        z = (axis_z * 15) / 100;
+        constexpr auto resolution = gleos::fixed<17, int16_t>::from(0.15); // uT/LSB
+        x = gleos::scale<int16_t>(axis_x, resolution);
+        y = gleos::scale<int16_t>(axis_y, resolution);
+        z = gleos::scale<int16_t>(axis_z, resolution);
+
+        if (m_correction)
+        {
+            m_correction->apply(x, y, z);
+        }
 
         break;
     }
@@ -11,9 +11,16 @@
 #pragma once
 
 #include "gleos/i2c.h"
+#include "gleos/calibration.h"
 
 class ak09918 : public gleos::i2c::driver
 {
+    // Correction applied after scaling, if any.
+    const gleos::calibration::correction *m_correction{nullptr};
+
+    // Event posted by the data ready line, if bound.
+    uint32_t m_data_ready;
+
 public:
     enum operation_mode
     {
@@ -27,7 +34,18 @@ public:
     };
 
 public:
-    ak09918(gleos::i2c::block &block);
+    /**
+     * Construct magnetometer driver.
+     * 
+     * Bind the data ready line with `event::bind_gpio` to its own
+     * flag, from `event::user` upwards. The `event::data_ready` flag
+     * may already belong to another sensor.
+     * 
+     * @param block         I2C block.
+     * @param data_ready    Event flag of the data ready line, or zero
+     *                      to poll every millisecond.
+     */
+    ak09918(gleos::i2c::block &block, uint32_t data_ready = 0);
 
     void set_operation_mode(operation_mode mode);
 
@@ -49,5 +67,16 @@ public:
     virtual void driver_reset() override;
     virtual bool driver_set_power_mode(power_mode mode) override;
 
+    /**
+     * Set the correction of the magnetometer.
+     * 
+     * The correction is applied on every read and must outlive
+     * the driver. Pass nullptr to read uncorrected values.
+     */
+    inline void set_calibration(const gleos::calibration::correction *correction)
+    {
+        m_correction = correction;
+    }
+
     void read_mag_vector3(int16_t &x, int16_t &y, int16_t &z);
 };
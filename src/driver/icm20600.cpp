@@ -84,6 +84,7 @@
 #define ICM20600_FIFO_RST_BIT (1 << 2)
 #define ICM20600_RESET_BIT (1 << 0)
 #define ICM20600_DEVICE_RESET_BIT (1 << 7)
+#define ICM20600_DATA_RDY_INT_EN_BIT (1 << 0)
 
 icm20600::icm20600(gleos::i2c::block &block)
     : gleos::i2c::driver{block, I2C_ADDRESS}
@@ -91,6 +92,10 @@ icm20600::icm20600(gleos::i2c::block &block)
     // Configuration
     m_i2c.write_register_byte(ICM20600_CONFIG, 0x00);
 
+    // Output every internal sample, the output data rates below are
+    // the internal rates.
+    m_i2c.write_register_byte(ICM20600_SMPLRT_DIV, 0x00);
+
     // Disable the FIFO by default.
     enable_fifo(false);
 
@@ -113,6 +118,13 @@ void icm20600::enable_fifo(bool enable)
     m_i2c.write_register_byte(ICM20600_FIFO_EN, enable ? ICM20600_FIFO_EN_BIT : 0x00);
 }
 
+void icm20600::enable_data_ready_interrupt(bool enable)
+{
+    // The INT pin is active high and push-pull by default. Unlatched,
+    // it pulses for each sample.
+    m_i2c.write_register_byte(ICM20600_INT_ENABLE, enable ? ICM20600_DATA_RDY_INT_EN_BIT : 0x00);
+}
+
 void icm20600::set_power_mode(power_mode mode)
 {
     uint8_t data_pwr1 = m_i2c.read_register_byte(ICM20600_PWR_MGMT_1);
@@ -180,22 +192,22 @@ void icm20600::set_acc_scale_range(acc_scale_type_t range)
     {
     case RANGE_2G:
         data |= 0x00; // 0bxxx00xxx
-        m_acc_scale = 4000;
+        m_acc_scale = gleos::q15::from(2000.0 / 32768);
         break;
 
     case RANGE_4G:
         data |= 0x08; // 0bxxx01xxx
-        m_acc_scale = 8000;
+        m_acc_scale = gleos::q15::from(4000.0 / 32768);
         break;
 
     case RANGE_8G:
         data |= 0x10; // 0bxxx10xxx
-        m_acc_scale = 16000;
+        m_acc_scale = gleos::q15::from(8000.0 / 32768);
         break;
 
     case RANGE_16G:
         data |= 0x18; // 0bxxx11xxx
-        m_acc_scale = 32000;
+        m_acc_scale = gleos::q15::from(16000.0 / 32768);
         break;
 
     default:
@@ -285,22 +297,22 @@ void icm20600::set_gyro_scale_range(gyro_scale_type_t range)
     {
     case RANGE_250_DPS:
         data |= 0x00; // 0bxxx00xxx
-        m_gyro_scale = 500;
+        m_gyro_scale = gleos::q15::from(250.0 / 32768);
         break;
 
     case RANGE_500_DPS:
         data |= 0x08; // 0bxxx00xxx
-        m_gyro_scale = 1000;
+        m_gyro_scale = gleos::q15::from(500.0 / 32768);
         break;
 
     case RANGE_1K_DPS:
         data |= 0x10; // 0bxxx10xxx
-        m_gyro_scale = 2000;
+        m_gyro_scale = gleos::q15::from(1000.0 / 32768);
         break;
 
     case RANGE_2K_DPS:
         data |= 0x18; // 0bxxx11xxx
-        m_gyro_scale = 4000;
+        m_gyro_scale = gleos::q15::from(2000.0 / 32768);
         break;
     }
 
@@ -404,23 +416,40 @@ void icm20600::read_acc_vector3(int16_t &x, int16_t &y, int16_t &z)
     auto y_raw = gleos::buffer_to_i16(&buffer[2]);
     auto z_raw = gleos::buffer_to_i16(&buffer[4]);
 
-    x = (x_raw * m_acc_scale) >> 16;
-    y = (y_raw * m_acc_scale) >> 16;
-    z = (z_raw * m_acc_scale) >> 16;
+    x = gleos::scale<int16_t>(x_raw, m_acc_scale);
+    y = gleos::scale<int16_t>(y_raw, m_acc_scale);
+    z = gleos::scale<int16_t>(z_raw, m_acc_scale);
+
+    if (m_acc_correction)
+    {
+        m_acc_correction->apply(x, y, z);
+    }
 }
 
-void icm20600::read_gyro_vector3(int16_t &x, int16_t &y, int16_t &z)
+void icm20600::read_gyro_raw(int16_t &x, int16_t &y, int16_t &z)
 {
     uint8_t buffer[] = {0, 0, 0, 0, 0, 0};
     m_i2c.read_register(ICM20600_GYRO_XOUT_H, buffer, sizeof(buffer));
 
-    auto x_raw = gleos::buffer_to_i16(&buffer[0]);
-    auto y_raw = gleos::buffer_to_i16(&buffer[2]);
-    auto z_raw = gleos::buffer_to_i16(&buffer[4]);
+    x = gleos::buffer_to_i16(&buffer[0]);
+    y = gleos::buffer_to_i16(&buffer[2]);
+    z = gleos::buffer_to_i16(&buffer[4]);
+}
+
+void icm20600::read_gyro_vector3(int16_t &x, int16_t &y, int16_t &z)
+{
+    int16_t x_raw, y_raw, z_raw;
+    read_gyro_raw(x_raw, y_raw, z_raw);
+
+    // The bias is far below 1 dps, it is removed before the scaling.
+    if (m_gyro_correction)
+    {
+        m_gyro_correction->apply(x_raw, y_raw, z_raw);
+    }
 
-    x = (x_raw * m_gyro_scale) >> 16;
-    y = (y_raw * m_gyro_scale) >> 16;
-    z = (z_raw * m_gyro_scale) >> 16;
+    x = gleos::scale<int16_t>(x_raw, m_gyro_scale);
+    y = gleos::scale<int16_t>(y_raw, m_gyro_scale);
+    z = gleos::scale<int16_t>(z_raw, m_gyro_scale);
 }
 
 void icm20600::read_temperature(int16_t &temp)
@@ -430,8 +459,10 @@ void icm20600::read_temperature(int16_t &temp)
 
     auto temp_raw = gleos::buffer_to_i16(&buffer[0]);
 
+    // Sensitivity is 326.8 LSB/°C with 0 LSB at room temperature.
+    constexpr auto resolution = gleos::fixed<23, int16_t>::from(1 / 326.8);
     const auto room_temperature = 25;
-    temp = temp_raw / 327 + room_temperature;
+    temp = gleos::scale<int16_t>(temp_raw, resolution) + room_temperature;
 }
 
 bool icm20600::driver_set_power_mode(driver::power_mode mode)
@@ -11,10 +11,17 @@
 #pragma once
 
 #include "gleos/i2c.h"
+#include "gleos/fixed.h"
+#include "gleos/calibration.h"
 
 class icm20600 : public gleos::i2c::driver
 {
-    uint16_t m_acc_scale{0}, m_gyro_scale{0};
+    // Resolution in mg and dps per LSB.
+    gleos::q15 m_acc_scale, m_gyro_scale;
+
+    // Correction applied after scaling, if any.
+    const gleos::calibration::correction *m_acc_correction{nullptr};
+    const gleos::calibration::correction *m_gyro_correction{nullptr};
 
     enum power_mode
     {
@@ -118,11 +125,41 @@ public:
      */
     void enable_fifo(bool enable);
 
+    /**
+     * Enable or disable the data ready interrupt.
+     * 
+     * The INT pin pulses high on each new sample, at the output
+     * data rate of 1 kHz. Bind the pin with `event::bind_gpio`.
+     * 
+     * @param True if the interrupt should be enabled, false otherwise.
+     */
+    void enable_data_ready_interrupt(bool enable);
+
     virtual bool driver_is_alive() override;
     virtual void driver_reset() override;
     virtual bool driver_set_power_mode(driver::power_mode mode) override;
 
+    /**
+     * Set the correction of the accelerometer and gyroscope.
+     * 
+     * The corrections are applied on every read and must outlive
+     * the driver. Pass nullptr to read uncorrected values. The
+     * gyroscope correction is applied on the raw counts.
+     */
+    inline void set_calibration(const gleos::calibration::correction *acc, const gleos::calibration::correction *gyro)
+    {
+        m_acc_correction = acc;
+        m_gyro_correction = gyro;
+    }
+
     void read_acc_vector3(int16_t &x, int16_t &y, int16_t &z);
     void read_gyro_vector3(int16_t &x, int16_t &y, int16_t &z);
+
+    /**
+     * Read the gyroscope in counts, without correction.
+     * 
+     * At the default range of 1000 dps one count is 30.5 mdps.
+     */
+    void read_gyro_raw(int16_t &x, int16_t &y, int16_t &z);
     void read_temperature(int16_t &temp);
 };
@@ -0,0 +1,319 @@
+/**
+ * Microcontroller firmware.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "mcp2515.h"
+
+#include <algorithm>
+#include <cstring>
+
+#define MCP2515_RESET 0xc0
+#define MCP2515_READ 0x03
+#define MCP2515_WRITE 0x02
+#define MCP2515_BIT_MODIFY 0x05
+#define MCP2515_READ_STATUS 0xa0
+#define MCP2515_READ_RX_BUFFER0 0x90
+#define MCP2515_READ_RX_BUFFER1 0x94
+#define MCP2515_LOAD_TX_BUFFER0 0x40
+#define MCP2515_RTS_TX_BUFFER0 0x81
+
+#define MCP2515_RXF0SIDH 0x00
+#define MCP2515_RXF1SIDH 0x04
+#define MCP2515_RXF2SIDH 0x08
+#define MCP2515_RXF3SIDH 0x10
+#define MCP2515_RXF4SIDH 0x14
+#define MCP2515_RXF5SIDH 0x18
+#define MCP2515_CANSTAT 0x0e
+#define MCP2515_CANCTRL 0x0f
+#define MCP2515_RXM0SIDH 0x20
+#define MCP2515_RXM1SIDH 0x24
+#define MCP2515_CNF3 0x28
+#define MCP2515_CNF2 0x29
+#define MCP2515_CNF1 0x2a
+#define MCP2515_CANINTE 0x2b
+#define MCP2515_CANINTF 0x2c
+#define MCP2515_TXB0CTRL 0x30
+#define MCP2515_RXB0CTRL 0x60
+#define MCP2515_RXB1CTRL 0x70
+
+#define MCP2515_MODE_MASK 0xe0
+#define MCP2515_TXREQ_BIT 0x08
+#define MCP2515_EXIDE_BIT 0x08
+#define MCP2515_BUKT_BIT 0x04
+#define MCP2515_RXM_MASK 0x60
+#define MCP2515_RX0IF_BIT 0x01
+#define MCP2515_RX1IF_BIT 0x02
+
+/* Number of acceptance filters */
+#define MCP2515_FILTER_COUNT 6
+
+// Bit timing registers CNF1, CNF2, CNF3 per oscillator and bitrate.
+static const uint8_t bit_timing[2][4][3] = {
+    // 8MHz oscillator
+    {
+        {0x01, 0xb1, 0x85},
+        {0x00, 0xb1, 0x85},
+        {0x00, 0x90, 0x82},
+        {0x00, 0x80, 0x80},
+    },
+    // 16MHz oscillator
+    {
+        {0x03, 0xf0, 0x86},
+        {0x41, 0xf1, 0x85},
+        {0x00, 0xf0, 0x86},
+        {0x00, 0xd0, 0x82},
+    },
+};
+
+// Encode identifier into the SIDH, SIDL, EID8 and EID0 register layout.
+static void encode_id(uint8_t *buffer, uint32_t id, bool is_extended)
+{
+    if (is_extended)
+    {
+        buffer[0] = static_cast<uint8_t>(id >> 21);
+        buffer[1] = static_cast<uint8_t>(((id >> 13) & 0xe0) | MCP2515_EXIDE_BIT | ((id >> 16) & 0x03));
+        buffer[2] = static_cast<uint8_t>(id >> 8);
+        buffer[3] = static_cast<uint8_t>(id);
+    }
+    else
+    {
+        buffer[0] = static_cast<uint8_t>(id >> 3);
+        buffer[1] = static_cast<uint8_t>((id << 5) & 0xe0);
+        buffer[2] = 0;
+        buffer[3] = 0;
+    }
+}
+
+static const uint8_t filter_register[MCP2515_FILTER_COUNT] = {
+    MCP2515_RXF0SIDH,
+    MCP2515_RXF1SIDH,
+    MCP2515_RXF2SIDH,
+    MCP2515_RXF3SIDH,
+    MCP2515_RXF4SIDH,
+    MCP2515_RXF5SIDH,
+};
+
+mcp2515::mcp2515(gleos::spi::block &block, bitrate rate, oscillator osc)
+    : gleos::spi::driver{block}
+{
+    driver_reset();
+
+    // The controller is in configuration mode after reset.
+    uint8_t timing[] = {
+        bit_timing[osc][rate][2],
+        bit_timing[osc][rate][1],
+        bit_timing[osc][rate][0],
+    };
+    write_register(MCP2515_CNF3, timing, sizeof(timing));
+
+    // Messages are polled, no interrupts.
+    uint8_t inte = 0x00;
+    write_register(MCP2515_CANINTE, &inte, 1);
+
+    // Accept all messages until filters are configured.
+    set_acceptance_filter(0, nullptr, 0);
+
+    set_operation_mode(operation_mode::normal);
+}
+
+uint8_t mcp2515::read_register(uint8_t reg)
+{
+    uint8_t command[] = {MCP2515_READ, reg};
+    uint8_t data = 0;
+    m_spi.read_transaction(command, sizeof(command), &data, 1);
+    return data;
+}
+
+void mcp2515::write_register(uint8_t reg, uint8_t *data, size_t len)
+{
+    uint8_t command[] = {MCP2515_WRITE, reg};
+    m_spi.write_transaction(command, sizeof(command), data, len);
+}
+
+void mcp2515::modify_register(uint8_t reg, uint8_t mask, uint8_t data)
+{
+    uint8_t command[] = {MCP2515_BIT_MODIFY, reg, mask, data};
+    m_spi.write_transaction(command, sizeof(command), nullptr, 0);
+}
+
+void mcp2515::write_id(uint8_t reg, uint32_t id, bool is_extended)
+{
+    uint8_t buffer[4];
+    encode_id(buffer, id, is_extended);
+
+    write_register(reg, buffer, sizeof(buffer));
+}
+
+bool mcp2515::set_operation_mode(operation_mode mode)
+{
+    modify_register(MCP2515_CANCTRL, MCP2515_MODE_MASK, mode);
+
+    // The mode change is not immediate. The controller waits until
+    // all pending transmissions are completed.
+    for (int i = 0; i < 10; ++i)
+    {
+        if ((read_register(MCP2515_CANSTAT) & MCP2515_MODE_MASK) == mode)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool mcp2515::driver_is_alive()
+{
+    const auto mode = read_register(MCP2515_CANSTAT) & MCP2515_MODE_MASK;
+    return mode == operation_mode::normal || mode == operation_mode::configuration || mode == operation_mode::loopback;
+}
+
+void mcp2515::driver_reset()
+{
+    uint8_t command = MCP2515_RESET;
+    m_spi.write_transaction(&command, 1, nullptr, 0);
+
+    // Wait for the oscillator start-up timer.
+    gleos::sleep(1);
+}
+
+bool mcp2515::driver_set_power_mode(power_mode mode)
+{
+    switch (mode)
+    {
+
+    case power_mode::sleep:
+        return set_operation_mode(operation_mode::sleep);
+
+    case power_mode::normal:
+        return set_operation_mode(operation_mode::normal);
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+bool mcp2515::write(const gleos::can::message &msg)
+{
+    if (msg.length > gleos::can::data_length_max)
+    {
+        return false;
+    }
+
+    // Only one transmit buffer is used. This guarantees messages leave
+    // the controller in the order they were written.
+    if (read_register(MCP2515_TXB0CTRL) & MCP2515_TXREQ_BIT)
+    {
+        return false;
+    }
+
+    uint8_t buffer[5 + gleos::can::data_length_max];
+
+    encode_id(buffer, msg.id, msg.is_extended);
+    buffer[4] = msg.length;
+    std::memcpy(buffer + 5, msg.data.data(), msg.length);
+
+    uint8_t command = MCP2515_LOAD_TX_BUFFER0;
+    m_spi.write_transaction(&command, 1, buffer, 5 + msg.length);
+
+    command = MCP2515_RTS_TX_BUFFER0;
+    m_spi.write_transaction(&command, 1, nullptr, 0);
+
+    return true;
+}
+
+void mcp2515::abort()
+{
+    // A message already on the bus completes first.
+    modify_register(MCP2515_TXB0CTRL, MCP2515_TXREQ_BIT, 0);
+}
+
+bool mcp2515::read(gleos::can::message &msg)
+{
+    uint8_t command = MCP2515_READ_STATUS;
+    uint8_t status = 0;
+    m_spi.read_transaction(&command, 1, &status, 1);
+
+    if (status & MCP2515_RX0IF_BIT)
+    {
+        command = MCP2515_READ_RX_BUFFER0;
+    }
+    else if (status & MCP2515_RX1IF_BIT)
+    {
+        command = MCP2515_READ_RX_BUFFER1;
+    }
+    else
+    {
+        return false;
+    }
+
+    // NOTE: The read RX buffer instruction clears the receive flag
+    //       once the chip select is released.
+    uint8_t buffer[5 + gleos::can::data_length_max];
+    m_spi.read_transaction(&command, 1, buffer, sizeof(buffer));
+
+    msg.is_extended = buffer[1] & MCP2515_EXIDE_BIT;
+    if (msg.is_extended)
+    {
+        msg.id = (static_cast<uint32_t>(buffer[0]) << 21) |
+                 (static_cast<uint32_t>(buffer[1] & 0xe0) << 13) |
+                 (static_cast<uint32_t>(buffer[1] & 0x03) << 16) |
+                 (static_cast<uint32_t>(buffer[2]) << 8) |
+                 buffer[3];
+    }
+    else
+    {
+        msg.id = (static_cast<uint32_t>(buffer[0]) << 3) | (buffer[1] >> 5);
+    }
+
+    msg.length = std::min<uint8_t>(buffer[4] & 0x0f, gleos::can::data_length_max);
+    std::memcpy(msg.data.data(), buffer + 5, msg.length);
+
+    return true;
+}
+
+bool mcp2515::set_acceptance_filter(uint32_t mask, const uint32_t *ids, size_t count)
+{
+    if (count > MCP2515_FILTER_COUNT)
+    {
+        return false;
+    }
+
+    const auto mode = read_register(MCP2515_CANSTAT) & MCP2515_MODE_MASK;
+
+    // Filters and masks can only be written in configuration mode.
+    if (!set_operation_mode(operation_mode::configuration))
+    {
+        return false;
+    }
+
+    // Without any identifiers the filters are turned off and
+    // every message is received.
+    uint8_t rxm = count ? 0x00 : MCP2515_RXM_MASK;
+
+    if (count)
+    {
+        // Both receive buffers share the same mask. Unused filter slots repeat
+        // the first identifier so they never widen the accept set.
+        write_id(MCP2515_RXM0SIDH, mask, true);
+        write_id(MCP2515_RXM1SIDH, mask, true);
+
+        for (size_t i = 0; i < MCP2515_FILTER_COUNT; ++i)
+        {
+            write_id(filter_register[i], ids[i < count ? i : 0], true);
+        }
+    }
+
+    // Let RXB0 roll over into RXB1 when it is full.
+    modify_register(MCP2515_RXB0CTRL, MCP2515_RXM_MASK | MCP2515_BUKT_BIT, rxm | MCP2515_BUKT_BIT);
+    modify_register(MCP2515_RXB1CTRL, MCP2515_RXM_MASK, rxm);
+
+    return set_operation_mode(static_cast<operation_mode>(mode));
+}
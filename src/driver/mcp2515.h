@@ -0,0 +1,67 @@
+/**
+ * Microcontroller firmware.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include "gleos/spi.h"
+#include "gleos/can.h"
+
+class mcp2515 : public gleos::spi::driver, public gleos::can::controller
+{
+public:
+    enum operation_mode
+    {
+        normal = 0x00,
+        sleep = 0x20,
+        loopback = 0x40,
+        listen_only = 0x60,
+        configuration = 0x80,
+    };
+
+    enum bitrate
+    {
+        rate_125kbps,
+        rate_250kbps,
+        rate_500kbps,
+        rate_1000kbps,
+    };
+
+    enum oscillator
+    {
+        osc_8mhz,
+        osc_16mhz,
+    };
+
+private:
+    uint8_t read_register(uint8_t reg);
+    void write_register(uint8_t reg, uint8_t *data, size_t len);
+    void modify_register(uint8_t reg, uint8_t mask, uint8_t data);
+
+    void write_id(uint8_t reg, uint32_t id, bool is_extended);
+
+public:
+    mcp2515(gleos::spi::block &block, bitrate rate = rate_500kbps, oscillator osc = osc_16mhz);
+
+    /**
+     * Move controller into operation mode.
+     * 
+     * @return True if the controller entered the mode, false otherwise.
+     */
+    bool set_operation_mode(operation_mode mode);
+
+    virtual bool driver_is_alive() override;
+    virtual void driver_reset() override;
+    virtual bool driver_set_power_mode(power_mode mode) override;
+
+    virtual bool write(const gleos::can::message &msg) override;
+    virtual void abort() override;
+    virtual bool read(gleos::can::message &msg) override;
+    virtual bool set_acceptance_filter(uint32_t mask, const uint32_t *ids, size_t count) override;
+};
@@ -0,0 +1,130 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/event.h"
+#include "gleos/stats.h"
+
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+
+#include <algorithm>
+#include <array>
+
+using namespace gleos;
+
+static volatile uint32_t pending;
+
+// Time of the first post of each pending flag.
+static std::array<uint32_t, 32> posted_at;
+
+static std::array<uint32_t, NUM_BANK0_GPIOS> gpio_flags;
+
+static stats::histogram wake_latency{"event.wake"};
+static stats::counter late_wakes{"event.late"};
+
+void event::post(uint32_t flags) noexcept
+{
+    const auto now = time_us_32();
+
+    const auto irq_state = save_and_disable_interrupts();
+
+    // A flag which is already pending keeps its first post time.
+    auto fresh = flags & ~pending;
+    while (fresh)
+    {
+        posted_at[__builtin_ctz(fresh)] = now;
+        fresh &= fresh - 1;
+    }
+
+    pending = pending | flags;
+
+    restore_interrupts(irq_state);
+
+    // Wake any core sleeping in WFE.
+    __sev();
+}
+
+uint32_t event::take(uint32_t mask) noexcept
+{
+    const auto now = time_us_32();
+
+    const auto irq_state = save_and_disable_interrupts();
+
+    const uint32_t taken = pending & mask;
+    pending = pending & ~taken;
+
+    // The latency of a wake-up is that of the longest waiting flag.
+    uint32_t latency = 0;
+    auto flags = taken;
+    while (flags)
+    {
+        latency = std::max(latency, now - posted_at[__builtin_ctz(flags)]);
+        flags &= flags - 1;
+    }
+
+    restore_interrupts(irq_state);
+
+    if (taken)
+    {
+        wake_latency.record(latency);
+        if (latency > wake_latency_max_us)
+        {
+            ++late_wakes;
+        }
+    }
+
+    return taken;
+}
+
+uint32_t event::wait(uint32_t mask) noexcept
+{
+    while (true)
+    {
+        if (const auto taken = take(mask))
+        {
+            return taken;
+        }
+
+        // A post between the check and the sleep leaves the event
+        // register set, in which case WFE returns at once.
+        __wfe();
+    }
+}
+
+uint32_t event::wait(uint32_t mask, clock::duration timeout) noexcept
+{
+    const deadline deadline{timeout};
+
+    while (true)
+    {
+        if (const auto taken = take(mask))
+        {
+            return taken;
+        }
+
+        if (best_effort_wfe_or_timeout(clock::to_absolute_time(deadline.expiry())))
+        {
+            return take(mask);
+        }
+    }
+}
+
+static void gpio_callback(uint gpio, uint32_t)
+{
+    event::post(gpio_flags[gpio]);
+}
+
+void event::bind_gpio(unsigned int gpio, bool rising, uint32_t flags) noexcept
+{
+    gpio_flags[gpio] = flags;
+
+    // The SDK supports a single callback for all pins.
+    gpio_set_irq_enabled_with_callback(gpio, rising ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL, true, gpio_callback);
+}
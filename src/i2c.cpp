@@ -9,13 +9,34 @@
  */
 
 #include "gleos/i2c.h"
+#include "gleos/stats.h"
 
 #include "hardware/gpio.h"
 
 using namespace gleos::i2c;
 
+static gleos::stats::counter nak_errors{"i2c.nak"};
+static gleos::stats::counter timeout_errors{"i2c.timeout"};
+
+/**
+ * Account bus errors reported by the SDK.
+ */
+static inline int account_errors(int ret)
+{
+    if (ret == PICO_ERROR_GENERIC)
+    {
+        ++nak_errors;
+    }
+    else if (ret == PICO_ERROR_TIMEOUT)
+    {
+        ++timeout_errors;
+    }
+
+    return ret;
+}
+
 block::block(int port_sda, int port_scl, mode baudrate)
-    : m_instance{i2c_default}
+    : m_instance{i2c_default}, m_baudrate{baudrate}
 {
     i2c_init(i2c_default, baudrate * 1000);
 
@@ -31,6 +52,17 @@ block::~block()
     i2c_deinit(m_instance);
 }
 
+void block::retime(gleos::power::stage stage, uint32_t, void *context)
+{
+    // Transfers are blocking, none is in progress at this point.
+    if (stage == gleos::power::commit)
+    {
+        auto bus = static_cast<block *>(context);
+
+        i2c_set_baudrate(bus->m_instance, bus->m_baudrate * 1000);
+    }
+}
+
 layer3::layer3(block &block, uint8_t address)
     : m_block{block}, m_address{address}
 {
@@ -38,7 +70,7 @@ layer3::layer3(block &block, uint8_t address)
 
 int layer3::write(uint8_t *data, size_t len)
 {
-    return i2c_write_blocking(m_block.m_instance, m_address, data, len, false);
+    return account_errors(i2c_write_timeout_us(m_block.m_instance, m_address, data, len, false, GLEOS_DEFAULT_I2C_TIMEOUT_US));
 }
 
 int layer3::write_register_byte(uint8_t reg, uint8_t data)
@@ -49,13 +81,13 @@ int layer3::write_register_byte(uint8_t reg, uint8_t data)
 
 int layer3::read(uint8_t *data, size_t len)
 {
-    return i2c_read_blocking(m_block.m_instance, m_address, data, len, false);
+    return account_errors(i2c_read_timeout_us(m_block.m_instance, m_address, data, len, false, GLEOS_DEFAULT_I2C_TIMEOUT_US));
 }
 
 int layer3::read_register(uint8_t reg, uint8_t *data, size_t len)
 {
     auto ret = write(&reg, 1);
-    if (!ret)
+    if (ret < 1)
     {
         return ret;
     }
@@ -0,0 +1,146 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/interp.h"
+
+#if PICO_ON_DEVICE
+#include "hardware/interp.h"
+#endif
+
+#include <algorithm>
+
+using namespace gleos;
+
+/**
+ * Store a table entry of 2^size_log2 bytes.
+ */
+static inline void store_entry(void *out, size_t index, const void *entry, uint8_t size_log2)
+{
+    switch (size_log2)
+    {
+    case 0:
+        static_cast<uint8_t *>(out)[index] = *static_cast<const uint8_t *>(entry);
+        break;
+    case 1:
+        static_cast<uint16_t *>(out)[index] = *static_cast<const uint16_t *>(entry);
+        break;
+    default:
+        static_cast<uint32_t *>(out)[index] = *static_cast<const uint32_t *>(entry);
+        break;
+    }
+}
+
+void interp::software::scale(const scaling &scaling, const int16_t *in, int16_t *out, size_t count) noexcept
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int32_t value = (in[i] * scaling.factor + scaling.bias) >> scaling.shift;
+
+        out[i] = static_cast<int16_t>(std::clamp(value, scaling.min, scaling.max));
+    }
+}
+
+void interp::software::clamp(int32_t min, int32_t max, const int32_t *in, int32_t *out, size_t count) noexcept
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = std::clamp(in[i], min, max);
+    }
+}
+
+void interp::software::lookup(const void *table, uint8_t size_log2, uint8_t bits, uint8_t shift, const uint32_t *in, void *out, size_t count) noexcept
+{
+    const uint32_t mask = (1u << bits) - 1;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto index = (in[i] >> shift) & mask;
+
+        store_entry(out, i, static_cast<const uint8_t *>(table) + (index << size_log2), size_log2);
+    }
+}
+
+#if PICO_ON_DEVICE
+
+void interp::scale(const scaling &scaling, const int16_t *in, int16_t *out, size_t count) noexcept
+{
+    // Lane 0 of interpolator 1 is the only lane which can clamp. The
+    // shift is arithmetic by sign extension of the masked result.
+    auto config = interp_default_config();
+    interp_config_set_shift(&config, scaling.shift);
+    interp_config_set_mask(&config, 0, 31 - scaling.shift);
+    interp_config_set_signed(&config, true);
+    interp_config_set_clamp(&config, true);
+    interp_set_config(interp1, 0, &config);
+
+    interp1->base[0] = scaling.min;
+    interp1->base[1] = scaling.max;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        interp1->accum[0] = in[i] * scaling.factor + scaling.bias;
+        out[i] = static_cast<int16_t>(interp1->peek[0]);
+    }
+}
+
+void interp::clamp(int32_t min, int32_t max, const int32_t *in, int32_t *out, size_t count) noexcept
+{
+    // Lane 0 of interpolator 1 is the only lane which can clamp.
+    auto config = interp_default_config();
+    interp_config_set_signed(&config, true);
+    interp_config_set_clamp(&config, true);
+    interp_set_config(interp1, 0, &config);
+
+    interp1->base[0] = min;
+    interp1->base[1] = max;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        interp1->accum[0] = in[i];
+        out[i] = interp1->peek[0];
+    }
+}
+
+void interp::lookup(const void *table, uint8_t size_log2, uint8_t bits, uint8_t shift, const uint32_t *in, void *out, size_t count) noexcept
+{
+    // The index is moved into place as a byte offset, the lane
+    // adds the table base and yields the address of the entry.
+    auto config = interp_default_config();
+    interp_config_set_shift(&config, shift - size_log2);
+    interp_config_set_mask(&config, size_log2, size_log2 + bits - 1);
+    interp_set_config(interp0, 0, &config);
+
+    interp0->base[0] = reinterpret_cast<uintptr_t>(table);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        interp0->accum[0] = in[i];
+        store_entry(out, i, reinterpret_cast<const void *>(interp0->peek[0]), size_log2);
+    }
+}
+
+#else
+
+void interp::scale(const scaling &scaling, const int16_t *in, int16_t *out, size_t count) noexcept
+{
+    software::scale(scaling, in, out, count);
+}
+
+void interp::clamp(int32_t min, int32_t max, const int32_t *in, int32_t *out, size_t count) noexcept
+{
+    software::clamp(min, max, in, out, count);
+}
+
+void interp::lookup(const void *table, uint8_t size_log2, uint8_t bits, uint8_t shift, const uint32_t *in, void *out, size_t count) noexcept
+{
+    software::lookup(table, size_log2, bits, shift, in, out, count);
+}
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/interval.h"
+
+#include "hardware/sync.h"
+
+using namespace gleos;
+
+// NOTE: The list head is zero initialized before any constructor runs. This
+//       allows deferred timers with static storage to register themselves.
+static timer_interval *deferred_head;
+
+timer_interval::timer_interval(uint32_t delay_ms, callback_type callback, const char *name, mode mode)
+    : m_callback{callback}, m_task{name}, m_is_deferred{mode == mode::deferred}
+{
+    if (m_is_deferred)
+    {
+        const auto irq_state = save_and_disable_interrupts();
+
+        m_next = deferred_head;
+        deferred_head = this;
+
+        restore_interrupts(irq_state);
+    }
+
+    if (!add_repeating_timer_ms(delay_ms, timer_interval_callback, this, &m_timer))
+    {
+        // TODO: ...
+        printf("Failed to add timer\n");
+    }
+}
+
+timer_interval::~timer_interval()
+{
+    cancel_repeating_timer(&m_timer);
+
+    if (!m_is_deferred)
+    {
+        return;
+    }
+
+    const auto irq_state = save_and_disable_interrupts();
+
+    for (auto link = &deferred_head; *link; link = &(*link)->m_next)
+    {
+        if (*link == this)
+        {
+            *link = m_next;
+            break;
+        }
+    }
+
+    restore_interrupts(irq_state);
+}
+
+void timer_interval::run_deferred()
+{
+    for (auto timer = deferred_head; timer; timer = timer->m_next)
+    {
+        // Clear before the run, a trigger during the run is kept.
+        if (timer->m_is_due)
+        {
+            timer->m_is_due = false;
+            timer->run();
+        }
+    }
+}
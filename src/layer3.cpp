@@ -9,7 +9,11 @@
  */
 
 #include "gleos/layer3.h"
+#include "gleos/load.h"
+#include "gleos/stats.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cstring>
 #include <iostream>
 
@@ -18,37 +22,79 @@ using namespace gleos::ice;
 // TODO: std::array
 const uint8_t magic[2] = {0xc5, 0x34};
 
-struct checksum_helper
+static gleos::stats::counter rx_frames{"ice.rx"};
+static gleos::stats::counter tx_frames{"ice.tx"};
+static gleos::stats::counter rx_magic_errors{"ice.rx.magic"};
+static gleos::stats::counter rx_checksum_errors{"ice.rx.checksum"};
+static gleos::stats::counter rx_version_errors{"ice.rx.version"};
+static gleos::stats::counter rx_length_errors{"ice.rx.length"};
+static gleos::stats::counter tx_dropped{"ice.tx.dropped"};
+
+// Calculate the checksum over the packet header and the payload. Extended
+// frames include the length byte even though it is not stored in the buffer.
+static checksum_type frame_checksum(const uint8_t *buffer, size_t payload_length, bool is_extended)
 {
-    constexpr static size_t offset = packet::offset + ICE_PACKET_DATA_LEN;
+    if (!is_extended)
+    {
+        return gleos::crc16(buffer + packet::offset, ICE_PACKET_DATA_LEN);
+    }
 
-    checksum_type checksum;
-};
+    const uint8_t length = static_cast<uint8_t>(payload_length);
+
+    auto crc = gleos::crc16(buffer + packet::offset, sizeof(packet));
+    crc = gleos::crc16(&length, sizeof(length), crc);
+    return gleos::crc16(buffer + payload_offset, payload_length, crc);
+}
 
 frame::frame()
 {
     // FUTURE: Can this be removed?
-    std::memset(m_buffer.data(), '\0', 14);
+    std::memset(m_buffer.data(), '\0', frame_size);
+}
+
+void frame::set_payload_length(size_t length) noexcept
+{
+    m_payload_length = std::clamp(length, payload_size, payload_length_max);
+}
+
+bool frame::set_network_timestamp(timestamp_type timestamp) noexcept
+{
+    if (m_payload_length + sizeof(timestamp) > payload_length_max)
+    {
+        return false;
+    }
+
+    std::memcpy(m_buffer.data() + payload_offset + m_payload_length, &timestamp, sizeof(timestamp));
+    m_payload_length += sizeof(timestamp);
+
+    auto header = read<packet>();
+    header.payload_type = static_cast<payload>(header.payload_type | payload_timestamp_flag);
+    set(header);
+
+    return true;
 }
 
 bool frame::is_valid()
 {
     if (m_buffer[sizeof(magic[0])] != magic[1])
     {
-        std::cout << "Invalid magic" << std::endl;
+        ++rx_magic_errors;
         return false;
     }
 
-    auto local_crc = crc16(m_buffer.data() + packet::offset, ICE_PACKET_DATA_LEN);
-    if (local_crc != get<checksum_helper>()->checksum)
+    checksum_type remote_crc;
+    std::memcpy(&remote_crc, m_buffer.data() + payload_offset + m_payload_length, sizeof(remote_crc));
+
+    auto local_crc = frame_checksum(m_buffer.data(), m_payload_length, is_extended());
+    if (local_crc != remote_crc)
     {
-        std::cout << "Invalid checksum" << std::endl;
+        ++rx_checksum_errors;
         return false;
     }
 
-    if (get<packet>()->version != ICE_PROTO_VERSION)
+    if (get<packet>()->version != (is_extended() ? ICE_PROTO_VERSION_EXTENDED : ICE_PROTO_VERSION))
     {
-        std::cout << "Invalid version" << std::endl;
+        ++rx_version_errors;
         return false;
     }
 
@@ -66,104 +112,770 @@ void frame::build()
     m_buffer[0] = magic[0];
     m_buffer[1] = magic[1];
 
-    set(checksum_helper{
-        checksum : crc16(m_buffer.data() + packet::offset, ICE_PACKET_DATA_LEN)
-    });
+    // The frame layout follows from the payload length.
+    m_buffer[packet::offset] = is_extended() ? ICE_PROTO_VERSION_EXTENDED : ICE_PROTO_VERSION;
+
+    auto crc = frame_checksum(m_buffer.data(), m_payload_length, is_extended());
+    std::memcpy(m_buffer.data() + payload_offset + m_payload_length, &crc, sizeof(crc));
+}
+
+frame_handle::frame_handle(frame_handle &&other) noexcept
+    : m_pool{other.m_pool}, m_slot{other.m_slot}
+{
+    other.m_pool = nullptr;
+}
+
+frame_handle::~frame_handle()
+{
+    reset();
+}
+
+frame_handle &frame_handle::operator=(frame_handle &&other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+
+        m_pool = other.m_pool;
+        m_slot = other.m_slot;
+        other.m_pool = nullptr;
+    }
+
+    return *this;
+}
+
+void frame_handle::reset() noexcept
+{
+    if (m_pool)
+    {
+        m_pool->release(m_slot);
+        m_pool = nullptr;
+    }
+}
+
+uint8_t frame_handle::release() noexcept
+{
+    m_pool = nullptr;
+    return m_slot;
+}
+
+frame &frame_handle::operator*() const noexcept
+{
+    return m_pool->m_frames[m_slot];
+}
+
+frame *frame_handle::operator->() const noexcept
+{
+    return &m_pool->m_frames[m_slot];
+}
+
+frame_pool::frame_pool(frame *frames, uint8_t capacity)
+    : m_frames{frames}, m_capacity{capacity}
+{
+    m_free_mask = capacity < 32 ? (1u << capacity) - 1 : ~0u;
+
+    critical_section_init(&m_lock);
+}
+
+frame_pool::~frame_pool()
+{
+    critical_section_deinit(&m_lock);
+}
+
+frame_handle frame_pool::acquire() noexcept
+{
+    critical_section_enter_blocking(&m_lock);
+
+    if (!m_free_mask)
+    {
+        critical_section_exit(&m_lock);
+        return frame_handle{};
+    }
+
+    const auto slot = static_cast<uint8_t>(__builtin_ctz(m_free_mask));
+    m_free_mask &= ~(1u << slot);
+
+    critical_section_exit(&m_lock);
+
+    return frame_handle{this, slot};
+}
+
+frame_handle frame_pool::adopt(uint8_t slot) noexcept
+{
+    if (slot >= m_capacity)
+    {
+        return frame_handle{};
+    }
+
+    return frame_handle{this, slot};
+}
+
+size_t frame_pool::available() noexcept
+{
+    critical_section_enter_blocking(&m_lock);
+    const auto count = __builtin_popcount(m_free_mask);
+    critical_section_exit(&m_lock);
+
+    return count;
+}
+
+void frame_pool::release(uint8_t slot) noexcept
+{
+    critical_section_enter_blocking(&m_lock);
+    m_free_mask |= (1u << slot);
+    critical_section_exit(&m_lock);
+}
+
+frame_queue::frame_queue(frame_pool &pool, unsigned int capacity)
+    : m_pool{pool}
+{
+    queue_init(&m_queue, sizeof(uint8_t), capacity);
+}
+
+frame_queue::~frame_queue()
+{
+    // Return any queued frames to the pool.
+    while (pop())
+    {
+    }
+
+    queue_free(&m_queue);
+}
+
+bool frame_queue::push(frame_handle &handle) noexcept
+{
+    if (!handle)
+    {
+        return false;
+    }
+
+    assert(handle.m_pool == &m_pool);
+
+    if (!queue_try_add(&m_queue, &handle.m_slot))
+    {
+        return false;
+    }
+
+    handle.release();
+
+    return true;
+}
+
+frame_handle frame_queue::pop() noexcept
+{
+    uint8_t slot;
+    if (!queue_try_remove(&m_queue, &slot))
+    {
+        return frame_handle{};
+    }
+
+    return m_pool.adopt(slot);
+}
+
+bool address_filter::join(address_type group) noexcept
+{
+    if (!is_multicast(group))
+    {
+        return false;
+    }
+    else if (accepts(group))
+    {
+        return true;
+    }
+    else if (m_group_count == group_capacity)
+    {
+        return false;
+    }
+
+    m_groups[m_group_count++] = group;
+
+    return true;
 }
 
-layer3::layer3(uart &device, address_type address, std::pair<unsigned int, unsigned int> version)
-    : m_device{device}, m_address{address}, m_version{version}
+void address_filter::leave(address_type group) noexcept
 {
+    for (size_t i = 0; i < m_group_count; ++i)
+    {
+        if (m_groups[i] == group)
+        {
+            m_groups[i] = m_groups[--m_group_count];
+            break;
+        }
+    }
 }
 
-frame layer3::accept()
+uart_transport::uart_transport(serial &device, uint32_t baud_rate_max)
+    : m_device{device}, m_capability{link_rate_capability(baud_rate_max)}
 {
-    frame frame;
+    m_device.set_baud_rate(link_rates[0]);
+}
 
-    while (true)
+bool uart_transport::set_rate(uint8_t rate)
+{
+    if (rate > m_capability)
     {
-        // Keep reading until the first magic byte is found.
-        // Only thereafter we'll read the entire frame. Any
-        // buffer misalignments will be discarded.
-        while (m_device.read_byte() != magic[0])
+        return false;
+    }
+
+    m_device.set_baud_rate(link_rates[rate]);
+    m_rate = rate;
+    m_error_run = 0;
+
+    return true;
+}
+
+bool uart_transport::request_rate(uint8_t rate) noexcept
+{
+    if (rate > m_capability)
+    {
+        return false;
+    }
+
+    m_rate_requested = rate;
+    m_is_rate_requested = true;
+
+    return true;
+}
+
+void uart_transport::apply_requested_rate()
+{
+    if (m_is_rate_requested)
+    {
+        m_is_rate_requested = false;
+        set_rate(m_rate_requested);
+    }
+}
+
+void uart_transport::link_error()
+{
+    if (++m_error_run < GLEOS_ICE_LINK_FALLBACK_ERRORS || !m_rate)
+    {
+        return;
+    }
+
+    m_device.set_baud_rate(link_rates[0]);
+    m_rate = 0;
+    m_error_run = 0;
+
+    ++m_fallbacks;
+}
+
+void uart_transport::send(frame &frame)
+{
+    apply_requested_rate();
+
+    frame.build();
+
+    if (frame.is_extended())
+    {
+        const uint8_t length = static_cast<uint8_t>(frame.payload_length());
+
+        m_device.begin_transmission();
+        m_device.write(frame.buffer(), payload_offset);
+        m_device.write(&length, sizeof(length));
+        m_device.write(frame.buffer() + payload_offset, length + sizeof(checksum_type));
+        m_device.end_transmission();
+    }
+    else
+    {
+        m_device.write(frame.buffer(), frame_size);
+    }
+}
+
+bool uart_transport::receive_until(size_t end)
+{
+    while (m_rx_position < end)
+    {
+        if (!m_device.rx_has_data())
         {
-            tight_loop_contents();
+            return false;
         }
 
-        // Read the entire frame at once. This is the most efficient
-        // way to buffer data. It has the side effect that any frame
-        // is guaranteed to be natural aligned.
-        m_device.read(frame.buffer() + sizeof(magic[0]), frame_size - sizeof(magic[0]));
+        m_rx_frame.buffer()[m_rx_position++] = m_device.read_byte();
+    }
+
+    return true;
+}
+
+void uart_transport::restart_receive()
+{
+    m_rx_position = 0;
+    m_rx_end = 0;
+}
+
+bool uart_transport::try_receive(frame &frame)
+{
+    // The frame is gathered in the transport over as many calls as
+    // its bytes take to arrive. The rate only changes between frames.
+    if (!m_rx_position)
+    {
+        apply_requested_rate();
 
-        if (!frame.is_valid())
+        // Skip to the first magic byte. Any buffer
+        // misalignments will be discarded.
+        do
         {
-            continue;
+            if (!m_device.rx_has_data())
+            {
+                return false;
+            }
+        } while (m_device.read_byte() != magic[0]);
+
+        m_rx_frame.buffer()[0] = magic[0];
+        m_rx_position = sizeof(magic[0]);
+    }
+
+    if (m_rx_position < sizeof(magic))
+    {
+        if (!receive_until(sizeof(magic)))
+        {
+            return false;
         }
 
-        // Ignore misaddressed packets.
-        if (!frame.is_broadcast() && frame.address() != m_address)
+        if (m_rx_frame.buffer()[sizeof(magic[0])] != magic[1])
         {
-            std::cout << "Ignore packet with address: " << frame.address() << std::endl;
-            continue;
+            ++rx_magic_errors;
+            restart_receive();
+            link_error();
+            return false;
         }
+    }
 
-        return frame;
+    // The packet header determines the layout of
+    // the remainder of the frame.
+    if (!receive_until(payload_offset))
+    {
+        return false;
     }
+
+    if (!m_rx_end)
+    {
+        if (m_rx_frame.get<packet>()->version == ICE_PROTO_VERSION_EXTENDED)
+        {
+            if (!m_device.rx_has_data())
+            {
+                return false;
+            }
+
+            const auto length = m_device.read_byte();
+
+            // Extended frames are only sent when the payload does
+            // not fit a compact frame.
+            if (length <= payload_size || length > payload_length_max)
+            {
+                ++rx_length_errors;
+                restart_receive();
+                link_error();
+                return false;
+            }
+
+            m_rx_frame.set_payload_length(length);
+        }
+        else
+        {
+            m_rx_frame.set_payload_length(payload_size);
+        }
+
+        // The length byte of an extended frame is not kept, the
+        // buffer holds the frame in its compact layout.
+        m_rx_end = payload_offset + m_rx_frame.payload_length() + sizeof(checksum_type);
+    }
+
+    if (!receive_until(m_rx_end))
+    {
+        return false;
+    }
+
+    const auto length = m_rx_end;
+
+    restart_receive();
+
+    // Misaddressed frames are skipped without validation.
+    if (!m_filter.accepts(m_rx_frame.address()))
+    {
+        ++m_filtered;
+        return false;
+    }
+
+    if (!m_rx_frame.is_valid())
+    {
+        link_error();
+        return false;
+    }
+
+    m_error_run = 0;
+
+    // Stamped with the reception of the last byte, which does
+    // not depend on how late the frame is parsed.
+    std::memcpy(frame.buffer(), m_rx_frame.buffer(), length);
+    frame.set_payload_length(m_rx_frame.payload_length());
+    frame.set_timestamp(m_device.rx_timestamp());
+
+    return true;
 }
 
-void layer3::announce_device()
+void uart_transport::wait()
+{
+    m_device.wait_rx(event::timer);
+}
+
+can_transport::can_transport(can::controller &controller)
+    : m_controller{controller}
+{
+}
+
+void can_transport::send(frame &frame)
 {
-    frame frame;
+    // Extended and timestamped payloads do not fit a CAN message.
+    if (frame.payload_length() > can::data_length_max)
+    {
+        ++tx_dropped;
+        return;
+    }
+
+    can::message msg{
+        id : make_id(frame.address(), frame.get<packet>()->payload_type),
+        is_extended : true,
+        length : static_cast<uint8_t>(frame.payload_length()),
+    };
 
-    frame.set_address(address_family::broadcast);
+    std::memcpy(msg.data.data(), frame.buffer() + payload_offset, msg.length);
+
+    // Wait for the controller to free up its transmit buffer. A message
+    // which is never acknowledged, for example when no other node is on
+    // the bus, would hold the buffer forever. Abort it and drop this frame.
+    const deadline deadline{std::chrono::microseconds{GLEOS_ICE_CAN_TX_TIMEOUT_US}};
+    while (!m_controller.write(msg))
+    {
+        if (deadline.is_expired())
+        {
+            m_controller.abort();
+            ++tx_dropped;
+            return;
+        }
+
+        tight_loop_contents();
+    }
+}
+
+bool can_transport::try_receive(frame &frame)
+{
+    can::message msg;
+
+    if (!m_controller.read(msg))
+    {
+        return false;
+    }
+
+    const auto timestamp = time_us_32();
+
+    // Standard frames belong to other protocols on the bus.
+    if (!msg.is_extended)
+    {
+        return false;
+    }
+
+    const uint8_t version = (msg.id >> 24) & 0x1f;
+    if (version != ICE_PROTO_VERSION)
+    {
+        return false;
+    }
+
+    // Only filter in software if the controller could
+    // not hold the entire accept set.
+    if (!m_is_hardware_filter && !m_filter.accepts(static_cast<address_type>(msg.id)))
+    {
+        ++m_filtered;
+        return false;
+    }
+
+    // The checksum is omitted since the CAN controller has
+    // already verified the frame integrity.
+    frame.set_payload_length(msg.length);
+    frame.set_address(static_cast<address_type>(msg.id));
     frame.set(packet{
-        version : ICE_PROTO_VERSION,
-        payload_type : payload::device_info_type,
+        version : static_cast<uint8_t>(frame.is_extended() ? ICE_PROTO_VERSION_EXTENDED : ICE_PROTO_VERSION),
+        payload_type : static_cast<payload>(msg.id >> 16),
     });
-    frame.set(device_info{
+
+    std::memset(frame.buffer() + payload_offset, '\0', payload_size);
+    std::memcpy(frame.buffer() + payload_offset, msg.data.data(), msg.length);
+
+    frame.set_timestamp(timestamp);
+
+    return true;
+}
+
+void can_transport::set_address_filter(const address_filter &filter)
+{
+    transport::set_address_filter(filter);
+
+    // Only the version and address bits take part in the filter,
+    // any payload type is accepted.
+    const uint32_t mask = make_id(std::numeric_limits<address_type>::max(), static_cast<payload>(0), 0x1f);
+
+    std::array<uint32_t, 2 + address_filter::group_capacity> ids;
+    size_t count = 0;
+
+    ids[count++] = make_id(filter.address(), static_cast<payload>(0));
+    if (filter.accepts_broadcast())
+    {
+        ids[count++] = make_id(address_family::broadcast, static_cast<payload>(0));
+    }
+    for (size_t i = 0; i < filter.group_count(); ++i)
+    {
+        ids[count++] = make_id(filter.groups()[i], static_cast<payload>(0));
+    }
+
+    // Fall back to filtering in software when the controller
+    // runs out of acceptance filters.
+    m_is_hardware_filter = m_controller.set_acceptance_filter(mask, ids.data(), count);
+    if (!m_is_hardware_filter)
+    {
+        m_controller.set_acceptance_filter(0, nullptr, 0);
+    }
+}
+
+layer3::layer3(transport &transport, address_type address, std::pair<unsigned int, unsigned int> version)
+    : m_transport{transport}, m_address{address}, m_filter{address}, m_version{version}
+{
+    m_transport.set_address_filter(m_filter);
+}
+
+bool layer3::join_group(address_type group)
+{
+    if (!m_filter.join(group))
+    {
+        return false;
+    }
+
+    m_transport.set_address_filter(m_filter);
+
+    return true;
+}
+
+void layer3::leave_group(address_type group)
+{
+    m_filter.leave(group);
+    m_transport.set_address_filter(m_filter);
+}
+
+bool layer3::send(frame_handle frame)
+{
+    if (!frame)
+    {
+        return false;
+    }
+
+    m_transport.send(*frame);
+
+    ++tx_frames;
+
+    return true;
+}
+
+frame_handle layer3::accept()
+{
+    frame_handle frame;
+
+    // Wait for a frame to be returned to the pool. The pool
+    // can only be exhausted while other contexts hold frames.
+    while (!(frame = m_pool.acquire()))
+    {
+        tight_loop_contents();
+    }
+
+    // The transport only passes frames accepted by the address filter.
+    // The wait ends on timer events as well, so the deferred timers
+    // get to send while no frame arrives.
+    while (!m_transport.try_receive(*frame))
+    {
+        timer_interval::run_deferred();
+        m_transport.wait();
+    }
+
+    ++rx_frames;
+
+    return frame;
+}
+
+frame_handle layer3::try_accept()
+{
+    auto frame = m_pool.acquire();
+    if (!frame)
+    {
+        return frame;
+    }
+
+    if (!m_transport.try_receive(*frame))
+    {
+        return frame_handle{};
+    }
+
+    ++rx_frames;
+
+    return frame;
+}
+
+void layer3::announce_device()
+{
+    send(address_family::broadcast, device_info{
         address : m_address,
         version : static_cast<uint8_t>(m_version.second | (m_version.first << 4)),
         status : device_status::none,
+        capability : m_transport.capability(),
     });
-    frame.build();
-
-    m_device.write(frame.buffer(), frame_size);
 }
 
 void layer3::dispatch_temperature(address_type address, int16_t temperature)
 {
-    frame frame;
+    send(address, ice::temperature{{temperature}});
+}
 
-    frame.set_address(address);
-    frame.set(packet{
-        version : ICE_PROTO_VERSION,
-        payload_type : payload::measurement_temperature_type,
-    });
-    frame.set(scalar16{
-        value : temperature,
-    });
-    frame.build();
+void layer3::dispatch_acceleration(address_type address, int16_t x, int16_t y, int16_t z)
+{
+    send(address, acceleration{{x, y, z}});
+}
+
+void layer3::dispatch_acceleration(address_type address, const vector3x16_block &block)
+{
+    send(address, acceleration_block{block});
+}
 
-    m_device.write(frame.buffer(), frame_size);
+void layer3::dispatch_motion(address_type address, const motion9x16_block &block)
+{
+    send(address, motion_block{block});
 }
 
-void layer3::dispatch_acceleration(address_type address, int16_t x, int16_t y, int16_t z)
+size_t layer3::dispatch_statistics(address_type address, size_t index)
 {
-    frame frame;
+    ice::statistics block{
+        index : static_cast<uint8_t>(index),
+        count : 0,
+    };
 
-    frame.set_address(address);
-    frame.set(packet{
-        version : ICE_PROTO_VERSION,
-        payload_type : payload::measurement_acceleration_type,
-    });
-    frame.set(vector3x16{
-        x,
-        y,
-        z,
-    });
-    frame.build();
+    const auto append = [&block](const stats::entry *entry, statistic::field_type field, uint32_t value)
+    {
+        block.records[block.count++] = statistic{
+            id : entry->id,
+            field : field,
+            value : value,
+        };
+    };
+
+    for (; index < stats::count(); ++index)
+    {
+        const auto entry = stats::at(index);
+        const size_t records = entry->type == stats::kind::period ? 3 : 1;
+
+        if (block.count + records > ice::statistics::capacity)
+        {
+            break;
+        }
+
+        switch (entry->type)
+        {
+        case stats::kind::counter:
+            append(entry, statistic::current, static_cast<const stats::counter *>(entry->object)->value());
+            break;
+
+        case stats::kind::gauge:
+            append(entry, statistic::current, static_cast<const stats::gauge *>(entry->object)->value());
+            break;
+
+        case stats::kind::period:
+        {
+            const auto period = static_cast<const stats::period *>(entry->object);
+            append(entry, statistic::minimum, period->min());
+            append(entry, statistic::average, period->avg());
+            append(entry, statistic::maximum, period->max());
+            break;
+        }
+
+        case stats::kind::histogram:
+            append(entry, statistic::current, static_cast<const stats::histogram *>(entry->object)->total());
+            break;
+        }
+    }
+
+    send(address, block);
+
+    return index < stats::count() ? index : 0;
+}
 
-    m_device.write(frame.buffer(), frame_size);
+void layer3::dispatch_histograms(address_type address)
+{
+    static_assert(ice::histogram::bucket_count == stats::histogram::bucket_count);
+
+    for (size_t index = 0; index < stats::count(); ++index)
+    {
+        const auto entry = stats::at(index);
+        if (entry->type != stats::kind::histogram)
+        {
+            continue;
+        }
+
+        const auto histogram = static_cast<const stats::histogram *>(entry->object);
+
+        ice::histogram block{
+            id : entry->id,
+        };
+
+        for (size_t i = 0; i < stats::histogram::bucket_count; ++i)
+        {
+            block.buckets[i] = histogram->bucket(i);
+        }
+
+        send(address, block);
+    }
+}
+
+size_t layer3::dispatch_load(address_type address, const load::window &window, size_t index)
+{
+    cpu_load block{
+        index : static_cast<uint8_t>(index),
+        count : 0,
+    };
+
+    const auto append = [&block](uint16_t id, size_t core, uint16_t utilisation)
+    {
+        block.records[block.count++] = cpu_load_record{
+            id : id,
+            core : static_cast<uint8_t>(core),
+            utilisation : utilisation,
+        };
+    };
+
+    if (!index)
+    {
+        for (size_t core = 0; core < load::core_count; ++core)
+        {
+            append(cpu_load_record::idle, core, window.idle(core));
+        }
+    }
+
+    for (; index < load::count(); ++index)
+    {
+        const auto task = load::at(index);
+
+        if (block.count + load::core_count > cpu_load::capacity)
+        {
+            break;
+        }
+
+        // Only report the cores on which the task ever ran.
+        for (size_t core = 0; core < load::core_count; ++core)
+        {
+            if (task->busy(core))
+            {
+                append(task->id(), core, window.utilisation(index, core));
+            }
+        }
+    }
+
+    send(address, block);
+
+    return index < load::count() ? index : 0;
 }
 
 void broadcast_service::invoke() const
@@ -175,6 +887,37 @@ void broadcast_service::invoke() const
 }
 
 broadcast_service::broadcast_service(uint32_t delay_ms, layer3 &layer)
-    : timer_interval{delay_ms}, m_layer{layer}
+    : timer_interval{delay_ms, nullptr, "ice.broadcast", mode::deferred}, m_layer{layer}
+{
+}
+
+void statistics_service::invoke() const
+{
+    m_index = m_layer.dispatch_statistics(address_family::broadcast, m_index);
+    if (!m_index)
+    {
+        m_layer.dispatch_histograms(address_family::broadcast);
+    }
+}
+
+statistics_service::statistics_service(uint32_t delay_ms, layer3 &layer)
+    : timer_interval{delay_ms, nullptr, "ice.statistics", mode::deferred}, m_layer{layer}
+{
+}
+
+void load_service::invoke() const
+{
+    // Start a new window once all tasks of the
+    // previous window were reported.
+    if (!m_index)
+    {
+        m_window.update();
+    }
+
+    m_index = m_layer.dispatch_load(address_family::broadcast, m_window, m_index);
+}
+
+load_service::load_service(uint32_t delay_ms, layer3 &layer)
+    : timer_interval{delay_ms, nullptr, "ice.load", mode::deferred}, m_layer{layer}
 {
 }
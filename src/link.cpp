@@ -0,0 +1,132 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/link.h"
+
+#include <algorithm>
+
+using namespace gleos::ice;
+
+link_control::link_control(layer3 &layer, uart_transport &transport)
+    : m_layer{layer},
+      m_transport{transport},
+      m_capability_min{transport.capability()},
+      m_fallbacks_seen{transport.fallback_count()},
+      m_monitor{monitor_interval, [this]
+                { monitor(); },
+                "ice.link", timer_interval::mode::deferred}
+{
+}
+
+link_control::~link_control()
+{
+    if (m_alarm > 0)
+    {
+        cancel_alarm(m_alarm);
+    }
+}
+
+int64_t link_control::switch_callback(alarm_id_t, void *user_data)
+{
+    auto control = static_cast<link_control *>(user_data);
+
+    control->m_alarm = 0;
+
+    // The transport switches between frames, from the main loop. Wake
+    // a main loop which sleeps on the link so it switches in time.
+    if (control->m_transport.request_rate(control->m_pending))
+    {
+        ++control->m_switches;
+        event::post(event::timer);
+    }
+
+    return 0;
+}
+
+void link_control::schedule(uint8_t rate, uint16_t delay_ms)
+{
+    // A later proposal replaces the pending one.
+    if (m_alarm > 0)
+    {
+        cancel_alarm(m_alarm);
+    }
+
+    m_pending = rate;
+    m_alarm = add_alarm_in_ms(delay_ms, switch_callback, this, true);
+}
+
+bool link_control::propose(uint8_t rate, uint16_t delay_ms)
+{
+    // Never leave a device which announced a lower capability behind.
+    rate = std::min(rate, m_capability_min);
+
+    if (!m_layer.send(address_family::broadcast, ice::link_rate{
+                                                     rate : rate,
+                                                     delay_ms : delay_ms,
+                                                 }))
+    {
+        return false;
+    }
+
+    schedule(rate, delay_ms);
+
+    m_proposed = rate;
+    m_settle = 0;
+
+    return true;
+}
+
+void link_control::monitor()
+{
+    const auto fallbacks = m_transport.fallback_count();
+    if (fallbacks != m_fallbacks_seen)
+    {
+        m_fallbacks_seen = fallbacks;
+
+        // Tell the coordinator this device is back at the base rate.
+        m_layer.announce_device();
+
+        // The rate did not hold, a coordinator tries the next lower
+        // one. The other devices fall back on the corrupt frames, wait
+        // for them so the proposal reaches all at the base rate.
+        if (m_proposed)
+        {
+            m_retry = m_proposed - 1;
+            m_proposed = 0;
+            m_settle = settle_count;
+        }
+
+        return;
+    }
+
+    if (m_settle && !--m_settle && m_retry)
+    {
+        // Try again on the next check if the link is busy.
+        if (!propose(m_retry))
+        {
+            m_settle = 1;
+        }
+    }
+}
+
+void link_control::process(const ice::link_rate &message)
+{
+    if (message.rate > m_transport.capability())
+    {
+        return;
+    }
+
+    schedule(message.rate, message.delay_ms);
+}
+
+void link_control::observe(const ice::device_info &device_info) noexcept
+{
+    m_capability_min = std::min(m_capability_min, device_info.capability);
+}
@@ -0,0 +1,211 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/load.h"
+#include "gleos/shell.h"
+
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "pico/platform.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+using namespace gleos::load;
+
+// NOTE: The registry is zero initialized before any constructor runs. This
+//       allows tasks with static storage in any translation unit to
+//       register themselves.
+static std::array<task *, GLEOS_LOAD_REGISTRY_SIZE> registry;
+static size_t registry_size;
+
+// Innermost running scope per core.
+static scope *active[core_count];
+
+task::task(const char *name)
+    : m_name{name}, m_id{gleos::crc16(reinterpret_cast<const uint8_t *>(name), std::strlen(name))}
+{
+    const auto irq_state = save_and_disable_interrupts();
+
+    // The task is still accounted when the registry is full,
+    // it just cannot be read out.
+    if (registry_size < registry.size())
+    {
+        registry[registry_size++] = this;
+    }
+
+    restore_interrupts(irq_state);
+}
+
+task::~task()
+{
+    const auto irq_state = save_and_disable_interrupts();
+
+    for (size_t i = 0; i < registry_size; ++i)
+    {
+        if (registry[i] == this)
+        {
+            // Keep the registration order intact.
+            std::memmove(&registry[i], &registry[i + 1], (registry_size - i - 1) * sizeof(registry[0]));
+            --registry_size;
+            break;
+        }
+    }
+
+    restore_interrupts(irq_state);
+}
+
+scope::scope(task &task) noexcept
+    : m_task{task}
+{
+    const auto core = get_core_num();
+
+    // Any preempting scope has returned before this scope
+    // continues, so the chain of scopes behaves as a stack.
+    m_parent = active[core];
+    active[core] = this;
+
+    m_start = time_us_32();
+}
+
+scope::~scope()
+{
+    const auto elapsed = time_us_32() - m_start;
+    const auto core = get_core_num();
+
+    m_task.m_busy[core] += elapsed - m_nested;
+    if (m_parent)
+    {
+        m_parent->m_nested += elapsed;
+    }
+
+    active[core] = m_parent;
+}
+
+void window::update() noexcept
+{
+    const auto now = time_us_32();
+    const auto length = now - m_start;
+    if (!length)
+    {
+        return;
+    }
+
+    uint32_t busy[core_count]{};
+
+    for (size_t i = 0; i < registry_size; ++i)
+    {
+        const auto task = registry[i];
+        auto &entry = m_entries[i];
+
+        // Tasks move down when an earlier task is removed. A task
+        // which is not found was added during this window.
+        if (entry.source != task)
+        {
+            size_t found = i + 1;
+            while (found < registry.size() && m_entries[found].source != task)
+            {
+                ++found;
+            }
+
+            entry = found < registry.size() ? m_entries[found] : window::entry{source : task};
+        }
+
+        for (size_t core = 0; core < core_count; ++core)
+        {
+            const uint32_t delta = task->busy(core) - entry.busy_last[core];
+            entry.busy_last[core] += delta;
+            // Scopes which started in the previous window can
+            // exceed this window.
+            entry.utilisation[core] = std::min<uint64_t>(static_cast<uint64_t>(delta) * 1000 / length, 1000);
+
+            busy[core] += delta;
+        }
+    }
+
+    for (size_t core = 0; core < core_count; ++core)
+    {
+        m_idle[core] = busy[core] < length ? static_cast<uint64_t>(length - busy[core]) * 1000 / length : 0;
+    }
+
+    m_start = now;
+}
+
+size_t gleos::load::count() noexcept
+{
+    return registry_size;
+}
+
+const task *gleos::load::at(size_t index) noexcept
+{
+    if (index >= registry_size)
+    {
+        return nullptr;
+    }
+
+    return registry[index];
+}
+
+//
+// Shell command.
+//
+
+/**
+ * Write permille as percentage with one decimal.
+ */
+static void write_percentage(gleos::shell::writer &out, uint16_t permille)
+{
+    char field[10];
+    std::snprintf(field, sizeof(field), "%u.%u%%", permille / 10, permille % 10);
+
+    out.write_left(field, 10);
+}
+
+// The shell has its own window, the network reports are not disturbed.
+static window top_window;
+
+static gleos::shell::command top_command{
+    "top",
+    "",
+    "Show CPU load since the previous top",
+    [](const gleos::shell::arguments &, gleos::shell::writer &out, void *)
+    {
+        top_window.update();
+
+        out << ' ';
+        out.write_left("task", 20);
+        for (size_t core = 0; core < core_count; ++core)
+        {
+            out << "core" << core << "     ";
+        }
+        out << "\r\n";
+
+        out << ' ';
+        out.write_left("idle", 20);
+        for (size_t core = 0; core < core_count; ++core)
+        {
+            write_percentage(out, top_window.idle(core));
+        }
+        out << "\r\n";
+
+        for (size_t i = 0; i < registry_size; ++i)
+        {
+            out << ' ';
+            out.write_left(registry[i]->name(), 20);
+            for (size_t core = 0; core < core_count; ++core)
+            {
+                write_percentage(out, top_window.utilisation(i, core));
+            }
+            out << "\r\n";
+        }
+    },
+};
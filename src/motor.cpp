@@ -9,18 +9,27 @@
  */
 
 #include "gleos/motor.h"
+#include "gleos/stats.h"
 
+#include "hardware/sync.h"
+
+#include <algorithm>
 #include <cmath>
 
 using namespace gleos::actuator;
 
+static gleos::stats::counter expired_commands{"motor.expired"};
+
 motor::motor(int port_a, int port_b)
     : pulse_modulation{port_a, port_b}
 {
 }
 
-void motor::set_motion_value(int64_t value) noexcept
+void motor::apply(int32_t value) noexcept
 {
+    // Keep the value in range so the ramp starts at the actual level.
+    value = std::clamp<int32_t>(value, -cycle_max, cycle_max);
+
     if (value > 0)
     {
         set_dual_channel(value, 0);
@@ -33,4 +42,68 @@ void motor::set_motion_value(int64_t value) noexcept
     {
         set_dual_channel(0, 0);
     }
+
+    m_value = value;
+}
+
+int64_t motor::expire_callback(alarm_id_t, void *user_data)
+{
+    auto self = reinterpret_cast<motor *>(user_data);
+
+    // First expiry, determine the step size so the
+    // ramp always takes the same time.
+    if (!self->m_ramp_step)
+    {
+        self->m_ramp_step = (std::abs(self->m_value) + ramp_steps - 1) / ramp_steps;
+
+        ++expired_commands;
+    }
+
+    if (std::abs(self->m_value) <= self->m_ramp_step)
+    {
+        self->apply(0);
+        self->m_alarm = 0;
+        return 0;
+    }
+
+    self->apply(self->m_value > 0 ? self->m_value - self->m_ramp_step : self->m_value + self->m_ramp_step);
+
+    // Reschedule relative to the previous step to keep the ramp steady.
+    return -ramp_interval_us;
+}
+
+void motor::set_motion_value(int64_t value, uint32_t validity_ms) noexcept
+{
+    // The alarm must not run between the check and the cancel. Once it
+    // has returned its id is free and can be taken by another motor,
+    // which would then lose its alarm instead.
+    const auto irq_state = save_and_disable_interrupts();
+
+    // The pending expiry belongs to the previous value.
+    if (m_alarm)
+    {
+        cancel_alarm(m_alarm);
+        m_alarm = 0;
+    }
+
+    m_ramp_step = 0;
+
+    apply(std::clamp<int64_t>(value, -cycle_max, cycle_max));
+
+    if (value && validity_ms)
+    {
+        const auto alarm = add_alarm_in_ms(validity_ms, expire_callback, this, true);
+
+        // Without an alarm the value cannot expire, which is not safe.
+        if (alarm < 0)
+        {
+            apply(0);
+        }
+        else
+        {
+            m_alarm = alarm;
+        }
+    }
+
+    restore_interrupts(irq_state);
 }
@@ -0,0 +1,100 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/netclock.h"
+#include "gleos/clock.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace gleos;
+using namespace gleos::ice;
+
+uint64_t network_clock::at(uint64_t local) const noexcept
+{
+    const auto elapsed = static_cast<int64_t>(local - m_reference);
+
+    return local + m_offset + scale<int64_t>(elapsed, m_rate_factor);
+}
+
+uint64_t network_clock::now() const noexcept
+{
+    return at(clock::now_us());
+}
+
+uint64_t network_clock::expand(uint32_t timestamp) const noexcept
+{
+    const auto network = now();
+
+    return network - static_cast<int32_t>(static_cast<uint32_t>(network) - timestamp);
+}
+
+void network_clock::set_reference() noexcept
+{
+    m_offset = 0;
+    m_rate = 0;
+    m_rate_factor = {};
+    m_reference = clock::now_us();
+    m_is_synchronized = true;
+}
+
+bool network_clock::discipline(int64_t offset, uint32_t delay, uint64_t local) noexcept
+{
+    m_delay.set(static_cast<int32_t>(std::min<uint32_t>(delay, std::numeric_limits<int32_t>::max())));
+
+    // A long round trip means the request or the response was held up
+    // on one leg, which skews the offset. The minimum delay is aged on
+    // each outlier so the filter follows a link which got slower.
+    if (m_is_synchronized && delay > 2 * m_delay_min + delay_margin)
+    {
+        m_delay_min += m_delay_min / 8 + 1;
+        ++m_rejected;
+        return false;
+    }
+
+    const auto error = offset - static_cast<int64_t>(at(local) - local);
+
+    m_error.set(static_cast<int32_t>(std::clamp<int64_t>(error, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max())));
+
+    if (!m_is_synchronized || error > step_threshold || error < -step_threshold)
+    {
+        m_offset = offset;
+        m_reference = local;
+        m_delay_min = delay;
+        m_is_synchronized = true;
+        ++m_steps;
+        return true;
+    }
+
+    m_delay_min = std::min(m_delay_min, delay);
+
+    // The error accrued since the last correction is a measure of the
+    // remaining rate error. Only a part of it is corrected at once to
+    // keep the loop stable against the measurement noise. The half of
+    // the error left in the offset is seen again by the next measurement
+    // and feeds the rate once more. With these gains the error still
+    // shrinks by about 0.7 on each measurement, see test_netclock.
+    const auto elapsed = static_cast<int64_t>(local - m_reference);
+    const auto offset_now = static_cast<int64_t>(at(local) - local);
+
+    if (elapsed > 0)
+    {
+        m_rate = static_cast<int32_t>(std::clamp<int64_t>(m_rate + error * 1000000000 / elapsed / 4, -rate_max, rate_max));
+
+        // Rounded to nearest, the factor resolves about 1 ppb.
+        const auto scaled = static_cast<int64_t>(m_rate) << rate_factor::frac_bits;
+        m_rate_factor = rate_factor::from_raw(static_cast<int32_t>((scaled + (scaled < 0 ? -500000000 : 500000000)) / 1000000000));
+    }
+
+    m_offset = offset_now + error / 2;
+    m_reference = local;
+
+    return true;
+}
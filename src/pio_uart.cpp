@@ -0,0 +1,340 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/pio_uart.h"
+#include "gleos/load.h"
+#include "gleos/stats.h"
+
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/timer.h"
+
+#include "pio_uart.pio.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+using namespace gleos;
+
+/* PIO cycles per bit in both programs. */
+constexpr uint32_t cycles_per_bit = 8;
+
+/* Relative IRQ flag raised on a framing error or break. */
+constexpr uint irq_flag_error = 4;
+
+static stats::counter line_errors{"pio_uart.error"};
+
+// Instance of each receiving state machine.
+static std::array<pio_uart *, NUM_PIOS * NUM_PIO_STATE_MACHINES> irq_instances;
+
+static load::task irq_task{"pio_uart.irq"};
+
+// Transfer count reloaded into the receive channel by the
+// control channel each time the channel has run the ring.
+static uint32_t rx_transfer_count;
+
+/**
+ * Account receive errors latched since the last check.
+ */
+static inline void account_errors(PIO pio, uint sm)
+{
+    if (pio_interrupt_get(pio, irq_flag_error + sm))
+    {
+        ++line_errors;
+
+        pio_interrupt_clear(pio, irq_flag_error + sm);
+    }
+}
+
+pio_uart::pio_uart(PIO pio, uint port_tx, uint port_rx, int baud_rate, uint32_t event)
+    : m_pio{pio}, m_baud_rate{baud_rate}, m_rx_event{event}
+{
+    m_sm_tx = pio_claim_unused_sm(pio, true);
+    m_sm_rx = pio_claim_unused_sm(pio, true);
+    m_offset_tx = pio_add_program(pio, &pio_uart_tx_program);
+    m_offset_rx = pio_add_program(pio, &pio_uart_rx_program);
+
+    // Drive the TX pin high before the pin is handed to the
+    // state machine, so the line does not glitch low.
+    pio_sm_set_pins_with_mask(pio, m_sm_tx, 1u << port_tx, 1u << port_tx);
+    pio_sm_set_pindirs_with_mask(pio, m_sm_tx, 1u << port_tx, 1u << port_tx);
+    pio_gpio_init(pio, port_tx);
+
+    auto sm_config = pio_uart_tx_program_get_default_config(m_offset_tx);
+    sm_config_set_out_shift(&sm_config, true, false, 32);
+    sm_config_set_out_pins(&sm_config, port_tx, 1);
+    sm_config_set_sideset_pins(&sm_config, port_tx);
+    sm_config_set_fifo_join(&sm_config, PIO_FIFO_JOIN_TX);
+    pio_sm_init(pio, m_sm_tx, m_offset_tx, &sm_config);
+
+    pio_sm_set_consecutive_pindirs(pio, m_sm_rx, port_rx, 1, false);
+    pio_gpio_init(pio, port_rx);
+    gpio_pull_up(port_rx);
+
+    sm_config = pio_uart_rx_program_get_default_config(m_offset_rx);
+    sm_config_set_in_pins(&sm_config, port_rx);
+    sm_config_set_jmp_pin(&sm_config, port_rx);
+    sm_config_set_in_shift(&sm_config, true, false, 32);
+    sm_config_set_fifo_join(&sm_config, PIO_FIFO_JOIN_RX);
+    pio_sm_init(pio, m_sm_rx, m_offset_rx, &sm_config);
+
+    set_clkdiv(clock_get_hz(clk_sys));
+
+    m_dma_tx = dma_claim_unused_channel(true);
+    m_dma_rx = dma_claim_unused_channel(true);
+    m_dma_rx_ctrl = dma_claim_unused_channel(true);
+
+    // Feed the TX FIFO from the transmit buffer. Byte writes
+    // are replicated over the word, the program shifts out
+    // the low byte.
+    auto dma_config = dma_channel_get_default_config(m_dma_tx);
+    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_8);
+    channel_config_set_read_increment(&dma_config, true);
+    channel_config_set_write_increment(&dma_config, false);
+    channel_config_set_dreq(&dma_config, pio_get_dreq(pio, m_sm_tx, true));
+    dma_channel_configure(m_dma_tx, &dma_config, &pio->txf[m_sm_tx], m_tx_buffer, 0, false);
+
+    // Drain the RX FIFO into the ring. The received byte is
+    // in the top byte of the FIFO word.
+    dma_config = dma_channel_get_default_config(m_dma_rx);
+    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_8);
+    channel_config_set_read_increment(&dma_config, false);
+    channel_config_set_write_increment(&dma_config, true);
+    channel_config_set_ring(&dma_config, true, GLEOS_PIO_UART_RX_RING_BITS);
+    channel_config_set_dreq(&dma_config, pio_get_dreq(pio, m_sm_rx, false));
+    channel_config_set_chain_to(&dma_config, m_dma_rx_ctrl);
+    dma_channel_configure(m_dma_rx, &dma_config, m_rx_buffer, reinterpret_cast<io_rw_8 *>(&pio->rxf[m_sm_rx]) + 3, rx_buffer_size, false);
+
+    // Restart the receive channel whenever it completes. The
+    // write address has wrapped back to the start of the ring.
+    rx_transfer_count = rx_buffer_size;
+
+    dma_config = dma_channel_get_default_config(m_dma_rx_ctrl);
+    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&dma_config, false);
+    channel_config_set_write_increment(&dma_config, false);
+    dma_channel_configure(m_dma_rx_ctrl, &dma_config, &dma_hw->ch[m_dma_rx].al1_transfer_count_trig, &rx_transfer_count, 1, false);
+
+    dma_channel_start(m_dma_rx);
+
+    const auto irq = pio_get_index(pio) ? PIO1_IRQ_0 : PIO0_IRQ_0;
+
+    irq_instances[pio_get_index(pio) * NUM_PIO_STATE_MACHINES + m_sm_rx] = this;
+
+    irq_set_exclusive_handler(irq, pio_uart::irq_handler);
+    irq_set_enabled(irq, true);
+
+    pio_sm_set_enabled(pio, m_sm_tx, true);
+    pio_sm_set_enabled(pio, m_sm_rx, true);
+}
+
+pio_uart::~pio_uart()
+{
+    pio_set_irq0_source_enabled(m_pio, static_cast<pio_interrupt_source>(pis_interrupt0 + m_sm_rx), false);
+    irq_instances[pio_get_index(m_pio) * NUM_PIO_STATE_MACHINES + m_sm_rx] = nullptr;
+
+    pio_sm_set_enabled(m_pio, m_sm_tx, false);
+    pio_sm_set_enabled(m_pio, m_sm_rx, false);
+
+    // Break the chain first, an aborted channel can
+    // still trigger the channel it is chained to.
+    hw_clear_bits(&dma_hw->ch[m_dma_rx_ctrl].al1_ctrl, DMA_CH0_CTRL_TRIG_EN_BITS);
+
+    dma_channel_abort(m_dma_tx);
+    dma_channel_abort(m_dma_rx);
+    dma_channel_abort(m_dma_rx_ctrl);
+
+    dma_channel_unclaim(m_dma_tx);
+    dma_channel_unclaim(m_dma_rx);
+    dma_channel_unclaim(m_dma_rx_ctrl);
+
+    pio_remove_program(m_pio, &pio_uart_tx_program, m_offset_tx);
+    pio_remove_program(m_pio, &pio_uart_rx_program, m_offset_rx);
+
+    pio_sm_unclaim(m_pio, m_sm_tx);
+    pio_sm_unclaim(m_pio, m_sm_rx);
+}
+
+void pio_uart::irq_handler()
+{
+    load::scope scope{irq_task};
+
+    for (auto device : irq_instances)
+    {
+        if (!device)
+        {
+            continue;
+        }
+
+        const auto source = static_cast<pio_interrupt_source>(pis_interrupt0 + device->m_sm_rx);
+
+        // The flag is raised on every byte, only a
+        // waiting reader has the interrupt armed.
+        if ((device->m_pio->ints0 & (1u << source)) == 0)
+        {
+            continue;
+        }
+
+        pio_set_irq0_source_enabled(device->m_pio, source, false);
+        pio_interrupt_clear(device->m_pio, device->m_sm_rx);
+
+        // The reader found the ring empty before it armed the interrupt,
+        // so all bytes in the ring have just arrived. The DMA may still
+        // be moving the byte which raised the flag.
+        device->m_rx_stamp = time_us_32();
+        device->m_rx_stamped = std::max<size_t>((device->rx_head() - device->m_rx_tail) & (rx_buffer_size - 1), 1);
+
+        event::post(device->m_rx_event);
+    }
+}
+
+void pio_uart::wait_tx_idle() const
+{
+    dma_channel_wait_for_finish_blocking(m_dma_tx);
+
+    // The state machine stalls on the empty FIFO once
+    // the last byte has been shifted out.
+    const uint32_t stall = 1u << (PIO_FDEBUG_TXSTALL_LSB + m_sm_tx);
+
+    m_pio->fdebug = stall;
+    while (!(m_pio->fdebug & stall))
+    {
+        tight_loop_contents();
+    }
+}
+
+void pio_uart::set_clkdiv(uint32_t sys_hz)
+{
+    // Divider in 1/256 steps, the state machines
+    // cannot run faster than the system clock.
+    const auto div = std::max<uint64_t>((static_cast<uint64_t>(sys_hz) << 8) / (cycles_per_bit * m_baud_rate), 1u << 8);
+
+    pio_sm_set_clkdiv_int_frac(m_pio, m_sm_tx, div >> 8, div & 0xff);
+    pio_sm_set_clkdiv_int_frac(m_pio, m_sm_rx, div >> 8, div & 0xff);
+}
+
+void pio_uart::retime(power::stage stage, uint32_t sys_hz, void *context)
+{
+    auto device = static_cast<pio_uart *>(context);
+
+    if (stage == power::prepare)
+    {
+        // Let pending output leave the line at the old rate.
+        device->wait_tx_idle();
+    }
+    else
+    {
+        device->set_clkdiv(sys_hz);
+    }
+}
+
+size_t pio_uart::rx_head() const noexcept
+{
+    return (dma_hw->ch[m_dma_rx].write_addr - reinterpret_cast<uintptr_t>(m_rx_buffer)) & (rx_buffer_size - 1);
+}
+
+bool pio_uart::rx_has_data() const noexcept
+{
+    return rx_head() != m_rx_tail;
+}
+
+void pio_uart::wait_rx(uint32_t events)
+{
+    const auto source = static_cast<pio_interrupt_source>(pis_interrupt0 + m_sm_rx);
+
+    // Arm the interrupt before the last check for data, a byte
+    // received in between would not wake the core otherwise.
+    pio_interrupt_clear(m_pio, m_sm_rx);
+    pio_set_irq0_source_enabled(m_pio, source, true);
+
+    if (rx_has_data())
+    {
+        pio_set_irq0_source_enabled(m_pio, source, false);
+        return;
+    }
+
+    // Disarm again when the wait ended on another event.
+    if (!(event::wait(m_rx_event | events) & m_rx_event))
+    {
+        pio_set_irq0_source_enabled(m_pio, source, false);
+    }
+}
+
+bool pio_uart::tx_has_space() const noexcept
+{
+    return !dma_channel_is_busy(m_dma_tx) && !pio_sm_is_tx_fifo_full(m_pio, m_sm_tx);
+}
+
+void pio_uart::set_baud_rate(int baud_rate)
+{
+    wait_tx_idle();
+
+    m_baud_rate = baud_rate;
+    set_clkdiv(clock_get_hz(clk_sys));
+}
+
+void pio_uart::write_putc(char c)
+{
+    dma_channel_wait_for_finish_blocking(m_dma_tx);
+
+    pio_sm_put_blocking(m_pio, m_sm_tx, static_cast<uint8_t>(c));
+}
+
+void pio_uart::write(const uint8_t *buffer, size_t len)
+{
+    while (len)
+    {
+        const auto count = std::min(len, sizeof(m_tx_buffer));
+
+        dma_channel_wait_for_finish_blocking(m_dma_tx);
+
+        std::memcpy(m_tx_buffer, buffer, count);
+        dma_channel_transfer_from_buffer_now(m_dma_tx, m_tx_buffer, count);
+
+        buffer += count;
+        len -= count;
+    }
+}
+
+uint8_t pio_uart::read_byte()
+{
+    while (!rx_has_data())
+    {
+        wait_rx();
+    }
+
+    account_errors(m_pio, m_sm_rx);
+
+    const auto c = m_rx_buffer[m_rx_tail];
+    m_rx_tail = (m_rx_tail + 1) % rx_buffer_size;
+
+    if (m_rx_stamped)
+    {
+        m_rx_stamped = m_rx_stamped - 1;
+        m_rx_timestamp = m_rx_stamp;
+    }
+    else
+    {
+        m_rx_timestamp = time_us_32();
+    }
+
+    return c;
+}
+
+void pio_uart::read(uint8_t *buffer, size_t len)
+{
+    while (len--)
+    {
+        *buffer++ = read_byte();
+    }
+}
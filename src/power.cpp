@@ -0,0 +1,163 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/power.h"
+#include "gleos/shell.h"
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+
+#include <array>
+#include <cstring>
+
+/* Time for the regulator output to settle after a voltage change. */
+#define VREG_SETTLE_US 1000
+
+using namespace gleos::power;
+
+// NOTE: The registry is zero initialized before any constructor runs. This
+//       allows listeners with static storage in any translation unit to
+//       register themselves.
+static std::array<const listener *, GLEOS_POWER_REGISTRY_SIZE> registry;
+static size_t registry_size;
+
+static profile active = nominal;
+
+listener::listener(retime_type retime, void *context)
+    : retime{retime}, context{context}
+{
+    const auto irq_state = save_and_disable_interrupts();
+
+    // The listener is silently lost when the registry is full.
+    if (registry_size < registry.size())
+    {
+        registry[registry_size++] = this;
+    }
+
+    restore_interrupts(irq_state);
+}
+
+listener::~listener()
+{
+    const auto irq_state = save_and_disable_interrupts();
+
+    for (size_t i = 0; i < registry_size; ++i)
+    {
+        if (registry[i] == this)
+        {
+            // Keep the registration order intact.
+            std::memmove(&registry[i], &registry[i + 1], (registry_size - i - 1) * sizeof(registry[0]));
+            --registry_size;
+            break;
+        }
+    }
+
+    restore_interrupts(irq_state);
+}
+
+/**
+ * Call all listeners for a stage of the clock change.
+ */
+static void notify(stage stage)
+{
+    const auto sys_hz = clock_get_hz(clk_sys);
+
+    for (size_t i = 0; i < registry_size; ++i)
+    {
+        registry[i]->retime(stage, sys_hz, registry[i]->context);
+    }
+}
+
+bool gleos::power::set_profile(const profile &profile) noexcept
+{
+    uint vco_freq, post_div1, post_div2;
+    if (!check_sys_clock_khz(profile.sys_khz, &vco_freq, &post_div1, &post_div2))
+    {
+        return false;
+    }
+
+    const auto irq_state = save_and_disable_interrupts();
+
+    notify(stage::prepare);
+
+    // The core may never run faster than the voltage allows. Raise
+    // the voltage ahead of the clock and lower it afterwards.
+    if (profile.voltage > active.voltage)
+    {
+        vreg_set_voltage(profile.voltage);
+        busy_wait_us_32(VREG_SETTLE_US);
+    }
+
+    // The peripheral clock follows the system clock.
+    set_sys_clock_pll(vco_freq, post_div1, post_div2);
+
+    if (profile.voltage < active.voltage)
+    {
+        vreg_set_voltage(profile.voltage);
+    }
+
+    notify(stage::commit);
+
+    active = profile;
+
+    restore_interrupts(irq_state);
+
+    return true;
+}
+
+const profile &gleos::power::current() noexcept
+{
+    return active;
+}
+
+//
+// Shell command.
+//
+
+static gleos::shell::command power_command{
+    "power",
+    "[low|nominal|high]",
+    "Show or set the power profile",
+    [](const gleos::shell::arguments &args, gleos::shell::writer &out, void *)
+    {
+        if (args.count() > 1)
+        {
+            const profile *profile = nullptr;
+
+            if (args.is(1, low.name))
+            {
+                profile = &low;
+            }
+            else if (args.is(1, nominal.name))
+            {
+                profile = &nominal;
+            }
+            else if (args.is(1, high.name) || args.is(1, "max"))
+            {
+                profile = &high;
+            }
+
+            if (!profile)
+            {
+                out << "usage: power [low|nominal|high]\r\n";
+                return;
+            }
+
+            if (!set_profile(*profile))
+            {
+                out << "power: clock not supported\r\n";
+                return;
+            }
+        }
+
+        out << "Profile: " << active.name << " (" << clock_get_hz(clk_sys) / 1000000 << "MHz)\r\n";
+    },
+};
@@ -9,7 +9,9 @@
  */
 
 #include "gleos/pwm.h"
+#include "gleos/stats.h"
 
+#include "hardware/clocks.h"
 #include "hardware/gpio.h"
 #include "hardware/pwm.h"
 #include "hardware/resets.h"
@@ -18,7 +20,7 @@
 
 using namespace gleos;
 
-const uint16_t cycle_max = 255;
+static stats::counter level_updates{"pwm.update"};
 
 pulse_modulation::pulse_modulation(int port_a, int port_b)
 {
@@ -29,8 +31,7 @@ pulse_modulation::pulse_modulation(int port_a, int port_b)
     assert(m_slice == pwm_gpio_to_slice_num(port_b));
 
     pwm_config config = pwm_get_default_config();
-    // TODO: It is unclear if we should keep this.
-    pwm_config_set_clkdiv(&config, 8.f);
+    pwm_config_set_clkdiv(&config, static_cast<float>(clock_get_hz(clk_sys)) / counter_frequency);
     pwm_config_set_wrap(&config, cycle_max);
     pwm_init(m_slice, &config, m_is_enabled);
 
@@ -38,6 +39,15 @@ pulse_modulation::pulse_modulation(int port_a, int port_b)
     pwm_set_both_levels(m_slice, m_chan_a_value, m_chan_b_value);
 }
 
+void pulse_modulation::retime(power::stage stage, uint32_t sys_hz, void *context)
+{
+    // Keep the output frequency regardless of the system clock.
+    if (stage == power::commit)
+    {
+        pwm_set_clkdiv(static_cast<pulse_modulation *>(context)->m_slice, static_cast<float>(sys_hz) / counter_frequency);
+    }
+}
+
 void pulse_modulation::reset() noexcept
 {
     reset_block(RESETS_RESET_PWM_BITS);
@@ -72,6 +82,7 @@ void pulse_modulation::set_channel(unsigned int channel, uint16_t value) noexcep
         {
             pwm_set_chan_level(m_slice, PWM_CHAN_A, value_new);
             m_chan_a_value = value_new;
+            ++level_updates;
         }
         break;
 
@@ -80,6 +91,7 @@ void pulse_modulation::set_channel(unsigned int channel, uint16_t value) noexcep
         {
             pwm_set_chan_level(m_slice, PWM_CHAN_B, value_new);
             m_chan_b_value = value_new;
+            ++level_updates;
         }
         break;
     }
@@ -100,6 +112,7 @@ void pulse_modulation::set_dual_channel(uint16_t value_a, uint16_t value_b) noex
 
         m_chan_a_value = value_a_new;
         m_chan_b_value = value_b_new;
+        ++level_updates;
     }
 }
 
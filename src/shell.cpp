@@ -10,145 +10,422 @@
 
 #include "gleos/shell.h"
 #include "gleos/status.h"
+#include "gleos/stats.h"
 
-#include "hardware/vreg.h"
+#include "hardware/sync.h"
 
-#include <sstream>
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 using namespace gleos;
 
-shell::shell(uart &device)
-    : m_device{device}
-{
-    status::init();
+static stats::counter dropped_output{"shell.dropped"};
+
+// NOTE: The registry is zero initialized before any constructor runs. This
+//       allows commands with static storage in any translation unit to
+//       register themselves.
+static std::array<const shell::command *, GLEOS_SHELL_REGISTRY_SIZE> registry;
+static size_t registry_size;
 
-    std::stringstream ss;
+shell::command::command(const char *name, const char *usage, const char *help, handler_type handler, void *context)
+    : name{name}, usage{usage}, help{help}, handler{handler}, context{context}
+{
+    const auto irq_state = save_and_disable_interrupts();
 
-    ss << "\r\nGlonax Embedded Operating System\r\n"
-       << "Firmware version : " << GLEOS_FIRMWARE_VERSION_MAJOR << "." << GLEOS_FIRMWARE_VERSION_MINOR << "\r\n"
-       << "\r\n"
-       << "Type 'help' to see available commands\r\n"
-       << "\r\n";
+    // The command is silently lost when the registry is full.
+    if (registry_size < registry.size())
+    {
+        registry[registry_size++] = this;
+    }
 
-    m_device << ss.str();
+    restore_interrupts(irq_state);
 }
 
-std::string shell::read_command()
+shell::command::~command()
 {
-    std::string command_buffer;
+    const auto irq_state = save_and_disable_interrupts();
 
-    char c;
-    while ((c = m_device.read_byte()) != '\r')
+    for (size_t i = 0; i < registry_size; ++i)
     {
-        if (std::isprint(c))
+        if (registry[i] == this)
         {
-            command_buffer += c;
-            m_device.write_putc(c);
+            // Keep the registration order intact.
+            std::memmove(&registry[i], &registry[i + 1], (registry_size - i - 1) * sizeof(registry[0]));
+            --registry_size;
+            break;
         }
-        else if (c == '\177')
-        {
-            command_buffer.pop_back();
+    }
+
+    restore_interrupts(irq_state);
+}
 
-            // NOTE: Backspace terminal control is always tricky. Depending on
-            //       the OS and the terminal settings this may not work as
-            //       expected. There is no portable solution.
-            m_device << "\b \b";
+bool shell::arguments::is(size_t index, const char *str) const noexcept
+{
+    return index < m_count && !std::strcmp(m_values[index], str);
+}
+
+bool shell::arguments::to_int(size_t index, int32_t &value) const noexcept
+{
+    if (index >= m_count)
+    {
+        return false;
+    }
+
+    char *end;
+    const auto result = std::strtol(m_values[index], &end, 0);
+    if (end == m_values[index] || *end != '\0')
+    {
+        return false;
+    }
+
+    value = result;
+    return true;
+}
+
+void shell::writer::write(const char *data, size_t len)
+{
+    while (len--)
+    {
+        const auto head_next = (m_head + 1) % sizeof(m_buffer);
+        if (head_next == m_tail)
+        {
+            dropped_output.increment(len + 1);
+            return;
         }
+
+        m_buffer[m_head] = *data++;
+        m_head = head_next;
     }
+}
+
+void shell::writer::write_left(const char *str, size_t width)
+{
+    const auto len = std::strlen(str);
 
-    return command_buffer;
+    write(str, len);
+    while (width-- > len)
+    {
+        *this << ' ';
+    }
 }
 
-void shell::read()
+void shell::writer::write_unsigned(uint64_t value)
 {
-    m_device << "gleos $ ";
+    char digits[20];
+    size_t count = 0;
 
-    const auto command_buffer = read_command();
+    do
+    {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
 
-    m_device << "\r\n";
+    while (count--)
+    {
+        *this << digits[count];
+    }
+}
 
-    if (command_buffer.empty())
+void shell::writer::flush(serial &device)
+{
+    while (!empty() && device.tx_has_space())
     {
-        return;
+        device.write_putc(m_buffer[m_tail]);
+        m_tail = (m_tail + 1) % sizeof(m_buffer);
     }
-    else if (command_buffer == "help")
+}
+
+shell::writer &shell::writer::operator<<(const char *str)
+{
+    write(str, std::strlen(str));
+    return *this;
+}
+
+shell::writer &shell::writer::operator<<(char c)
+{
+    write(&c, 1);
+    return *this;
+}
+
+shell::shell(serial &device)
+    : m_device{device}
+{
+    status::init();
+
+    m_out << "\r\nGlonax Embedded Operating System\r\n"
+          << "Firmware version : " << GLEOS_FIRMWARE_VERSION_MAJOR << "." << GLEOS_FIRMWARE_VERSION_MINOR << "\r\n"
+          << "\r\n"
+          << "Type 'help' to see available commands\r\n"
+          << "\r\n";
+
+    prompt();
+}
+
+void shell::prompt()
+{
+    m_out << "gleos $ ";
+}
+
+void shell::execute()
+{
+    arguments args;
+
+    // Split the line in place. Each word is terminated
+    // by replacing the separator.
+    char *word = m_line;
+    while (args.m_count < argument_max)
     {
-        std::stringstream ss;
+        while (*word == ' ')
+        {
+            ++word;
+        }
+        if (*word == '\0')
+        {
+            break;
+        }
 
-        ss << "Commands:\r\n"
-           << " help                Show this help message\r\n"
-           << " uptime              System uptime in seconds\r\n"
-           << " id                  Show all IDs\r\n"
-           << " status led [on|off] Toggle status LED\r\n"
-           << " reboot              System soft reboot\r\n"
-           << " bootsel             Boot into BOOTSEL mode\r\n"
-           << " power max           Set the CPU power level\r\n"
-           << " version             Firmware version\r\n";
+        args.m_values[args.m_count++] = word;
 
-        m_device << ss.str();
+        word = std::strchr(word, ' ');
+        if (!word)
+        {
+            break;
+        }
+        *word++ = '\0';
     }
-    else if (command_buffer == "status led on")
+
+    if (!args.count())
     {
-        status::status_led(true);
+        return;
     }
-    else if (command_buffer == "status led off")
+
+    for (size_t i = 0; i < registry_size; ++i)
     {
-        status::status_led(false);
+        if (args.is(0, registry[i]->name))
+        {
+            registry[i]->handler(args, m_out, registry[i]->context);
+            return;
+        }
     }
-    else if (command_buffer == "uptime")
+
+    m_out << args[0] << ": command not found\r\n";
+}
+
+void shell::poll()
+{
+    while (m_device.rx_has_data())
     {
-        std::stringstream ss;
+        const char c = m_device.read_byte();
 
-        ss << "up "
-           << sec_since_boot()
-           << " seconds \r\n";
+        if (c == '\r')
+        {
+            m_out << "\r\n";
+
+            m_line[m_line_length] = '\0';
+            execute();
+            m_line_length = 0;
 
-        m_device << ss.str();
+            prompt();
+        }
+        else if (c == '\177')
+        {
+            if (m_line_length)
+            {
+                --m_line_length;
+
+                // NOTE: Backspace terminal control is always tricky. Depending on
+                //       the OS and the terminal settings this may not work as
+                //       expected. There is no portable solution.
+                m_out << "\b \b";
+            }
+        }
+        else if (std::isprint(c) && m_line_length < line_length - 1)
+        {
+            m_line[m_line_length++] = c;
+            m_out << c;
+        }
     }
-    else if (command_buffer == "id")
+
+    m_out.flush(m_device);
+}
+
+//
+// Builtin commands.
+//
+
+static shell::command help_command{
+    "help",
+    "",
+    "Show this help message",
+    [](const shell::arguments &, shell::writer &out, void *)
     {
-        std::stringstream ss;
+        out << "Commands:\r\n";
 
-        ss << "Hardware ID: "
-           << unique_id()
-           << "\r\n";
+        for (size_t i = 0; i < registry_size; ++i)
+        {
+            const auto command = registry[i];
 
-        ss << "Device ID: "
-           << device_id
-           << "\r\n";
+            char line[20 + 1];
+            std::snprintf(line, sizeof(line), "%s %s", command->name, command->usage);
 
-        ss << "Instance ID: "
-           << instance_id()
-           << "\r\n";
+            out << ' ';
+            out.write_left(line, sizeof(line));
+            out << command->help << "\r\n";
+        }
+    },
+};
 
-        m_device << ss.str();
-    }
-    else if (command_buffer == "reboot")
+static shell::command uptime_command{
+    "uptime",
+    "",
+    "System uptime in seconds",
+    [](const shell::arguments &, shell::writer &out, void *)
+    {
+        out << "up " << sec_since_boot() << " seconds \r\n";
+    },
+};
+
+static shell::command id_command{
+    "id",
+    "",
+    "Show all IDs",
+    [](const shell::arguments &, shell::writer &out, void *)
+    {
+        out << "Hardware ID: " << unique_id() << "\r\n"
+            << "Device ID: " << device_id << "\r\n"
+            << "Instance ID: " << instance_id() << "\r\n";
+    },
+};
+
+static shell::command status_command{
+    "status",
+    "led [on|off]",
+    "Toggle status LED",
+    [](const shell::arguments &args, shell::writer &out, void *)
+    {
+        if (args.is(1, "led") && args.is(2, "on"))
+        {
+            status::status_led(true);
+        }
+        else if (args.is(1, "led") && args.is(2, "off"))
+        {
+            status::status_led(false);
+        }
+        else
+        {
+            out << "usage: status led [on|off]\r\n";
+        }
+    },
+};
+
+static shell::command reboot_command{
+    "reboot",
+    "",
+    "System soft reboot",
+    [](const shell::arguments &, shell::writer &, void *)
     {
         reboot();
-    }
-    else if (command_buffer == "bootsel")
+    },
+};
+
+static shell::command bootsel_command{
+    "bootsel",
+    "",
+    "Boot into BOOTSEL mode",
+    [](const shell::arguments &, shell::writer &, void *)
     {
         reboot(boot_mode::bootsel);
-    }
-    else if (command_buffer == "power max")
+    },
+};
+
+static shell::command version_command{
+    "version",
+    "",
+    "Firmware version",
+    [](const shell::arguments &, shell::writer &out, void *)
     {
-        vreg_set_voltage(VREG_VOLTAGE_MAX);
-    }
-    else if (command_buffer == "version")
+        out << "Firmware version: " << GLEOS_FIRMWARE_VERSION_MAJOR << "." << GLEOS_FIRMWARE_VERSION_MINOR << "\r\n";
+    },
+};
+
+static shell::command stats_command{
+    "stats",
+    "",
+    "Show runtime statistics",
+    [](const shell::arguments &, shell::writer &out, void *)
     {
-        std::stringstream ss;
+        for (size_t i = 0; i < stats::count(); ++i)
+        {
+            const auto entry = stats::at(i);
 
-        ss << "Firmware version: " << GLEOS_FIRMWARE_VERSION_MAJOR << "." << GLEOS_FIRMWARE_VERSION_MINOR << "\r\n";
+            out << ' ';
+            out.write_left(entry->name, 20);
 
-        m_device << ss.str();
-    }
-    else
+            switch (entry->type)
+            {
+            case stats::kind::counter:
+                out << static_cast<const stats::counter *>(entry->object)->value();
+                break;
+
+            case stats::kind::gauge:
+                out << static_cast<const stats::gauge *>(entry->object)->value();
+                break;
+
+            case stats::kind::period:
+            {
+                const auto period = static_cast<const stats::period *>(entry->object);
+                out << period->min() << "/" << period->avg() << "/" << period->max() << " us";
+                break;
+            }
+
+            case stats::kind::histogram:
+                out << static_cast<const stats::histogram *>(entry->object)->total() << " samples";
+                break;
+            }
+
+            out << "\r\n";
+        }
+
+        out << ' ';
+        out.write_left("stats.dropped", 20);
+        out << stats::dropped() << "\r\n";
+    },
+};
+
+static shell::command histogram_command{
+    "histogram",
+    "",
+    "Show latency histograms",
+    [](const shell::arguments &, shell::writer &out, void *)
     {
-        std::stringstream ss;
+        for (size_t i = 0; i < stats::count(); ++i)
+        {
+            const auto entry = stats::at(i);
+            if (entry->type != stats::kind::histogram)
+            {
+                continue;
+            }
 
-        ss << command_buffer << ": command not found\r\n";
+            const auto histogram = static_cast<const stats::histogram *>(entry->object);
 
-        m_device << ss.str();
-    }
-}
+            out << entry->name << " (us):\r\n";
+
+            // Empty buckets are omitted for brevity.
+            for (size_t j = 0; j < stats::histogram::bucket_count; ++j)
+            {
+                if (histogram->bucket(j))
+                {
+                    char bound[16];
+                    std::snprintf(bound, sizeof(bound), "%lu", static_cast<unsigned long>(stats::histogram::lower_bound(j)));
+
+                    out << " >= ";
+                    out.write_left(bound, 16);
+                    out << histogram->bucket(j) << "\r\n";
+                }
+            }
+        }
+    },
+};
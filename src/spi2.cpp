@@ -15,7 +15,7 @@
 using namespace gleos::spi;
 
 block::block(spi_inst_t *instance, int port_mosi, int port_simo, int port_sclk, int port_cs, int baudrate)
-    : m_instance{instance}, m_port_cs{port_cs}
+    : m_instance{instance}, m_port_cs{port_cs}, m_baudrate{baudrate}
 {
     // gpio_pull_up(port_sda);
     // gpio_pull_up(port_scl);
@@ -36,6 +36,23 @@ block::~block()
     spi_deinit(m_instance);
 }
 
+void block::retime(gleos::power::stage stage, uint32_t, void *context)
+{
+    auto bus = static_cast<block *>(context);
+
+    if (stage == gleos::power::prepare)
+    {
+        while (spi_is_busy(bus->m_instance))
+        {
+            tight_loop_contents();
+        }
+    }
+    else
+    {
+        spi_set_baudrate(bus->m_instance, bus->m_baudrate * 1000000);
+    }
+}
+
 bus::bus(block &block)
     : m_block{block}
 {
@@ -0,0 +1,143 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/stats.h"
+
+#include "pico/sync.h"
+#include "pico/time.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+using namespace gleos::stats;
+
+// NOTE: The registry is zero initialized before any constructor runs. This
+//       allows statistics with static storage in any translation unit to
+//       register themselves.
+static std::array<entry, GLEOS_STATS_REGISTRY_SIZE> registry;
+static size_t registry_size;
+static size_t registry_dropped;
+
+void detail::register_entry(const char *name, kind type, const void *object) noexcept
+{
+    const auto irq_state = save_and_disable_interrupts();
+
+    // The statistic keeps working when the registry is full,
+    // it just cannot be read out.
+    if (registry_size < registry.size())
+    {
+        registry[registry_size++] = entry{
+            name : name,
+            id : gleos::crc16(reinterpret_cast<const uint8_t *>(name), std::strlen(name)),
+            type : type,
+            object : object,
+        };
+    }
+    else
+    {
+        ++registry_dropped;
+    }
+
+    restore_interrupts(irq_state);
+}
+
+void detail::unregister_entry(const void *object) noexcept
+{
+    const auto irq_state = save_and_disable_interrupts();
+
+    for (size_t i = 0; i < registry_size; ++i)
+    {
+        if (registry[i].object == object)
+        {
+            // Keep the registration order intact.
+            std::memmove(&registry[i], &registry[i + 1], (registry_size - i - 1) * sizeof(entry));
+            --registry_size;
+            break;
+        }
+    }
+
+    restore_interrupts(irq_state);
+}
+
+void period::mark() noexcept
+{
+    const auto now = time_us_32();
+
+    // The first mark only sets the reference point.
+    if (m_last)
+    {
+        const auto interval = now - m_last;
+
+        if (!m_max)
+        {
+            m_min = interval;
+            m_avg = interval;
+            m_max = interval;
+        }
+        else
+        {
+            m_min = std::min(m_min, interval);
+            m_max = std::max(m_max, interval);
+
+            // Exponential moving average with a weight of 1/16.
+            m_avg = m_avg + (static_cast<int32_t>(interval - m_avg) >> 4);
+        }
+    }
+
+    m_last = now;
+}
+
+void period::reset() noexcept
+{
+    m_min = m_avg;
+    m_max = m_avg;
+}
+
+void histogram::record_since(uint32_t timestamp) noexcept
+{
+    record(time_us_32() - timestamp);
+}
+
+void histogram::reset() noexcept
+{
+    std::fill(std::begin(m_buckets), std::end(m_buckets), 0);
+}
+
+uint32_t histogram::total() const noexcept
+{
+    uint32_t total = 0;
+    for (const auto count : m_buckets)
+    {
+        total += count;
+    }
+
+    return total;
+}
+
+size_t gleos::stats::count() noexcept
+{
+    return registry_size;
+}
+
+size_t gleos::stats::dropped() noexcept
+{
+    return registry_dropped;
+}
+
+const entry *gleos::stats::at(size_t index) noexcept
+{
+    if (index >= registry_size)
+    {
+        return nullptr;
+    }
+
+    return &registry[index];
+}
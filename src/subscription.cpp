@@ -0,0 +1,142 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/subscription.h"
+
+#include <algorithm>
+
+using namespace gleos::ice;
+
+subscription_table::subscription_table(layer3 &layer)
+    : m_layer{layer}
+{
+}
+
+void subscription_table::remove(size_t index) noexcept
+{
+    // The order of the table carries no meaning.
+    m_subscriptions[index] = m_subscriptions[--m_count];
+}
+
+void subscription_table::expire() noexcept
+{
+    const auto now = gleos::ms_since_boot();
+
+    for (size_t i = 0; i < m_count;)
+    {
+        // Compare the difference so the millisecond counter may wrap.
+        if (static_cast<int32_t>(now - m_subscriptions[i].expiry_ms) >= 0)
+        {
+            remove(i);
+            ++m_expired;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+bool subscription_table::advance(subscription &entry) noexcept
+{
+    if (entry.phase > 0)
+    {
+        --entry.phase;
+        return false;
+    }
+
+    entry.phase = entry.decimation - 1;
+    return true;
+}
+
+bool subscription_table::offer(payload measurement, uint16_t rate) noexcept
+{
+    if (m_offer_count == m_offers.size())
+    {
+        return false;
+    }
+
+    m_offers[m_offer_count++] = offering{
+        measurement : measurement,
+        rate : rate,
+    };
+
+    return true;
+}
+
+bool subscription_table::process(const ice::subscribe &message) noexcept
+{
+    const auto source = std::find_if(m_offers.begin(), m_offers.begin() + m_offer_count, [&](const auto &entry)
+                                     { return entry.measurement == message.measurement; });
+    if (source == m_offers.begin() + m_offer_count)
+    {
+        ++m_rejected;
+        return false;
+    }
+
+    expire();
+
+    const auto entry = std::find_if(m_subscriptions.begin(), m_subscriptions.begin() + m_count, [&](const auto &entry)
+                                    { return entry.measurement == message.measurement && entry.destination == message.destination; });
+    const auto is_existing = entry != m_subscriptions.begin() + m_count;
+
+    if (message.rate == 0)
+    {
+        if (is_existing)
+        {
+            remove(entry - m_subscriptions.begin());
+        }
+
+        return true;
+    }
+
+    if (message.lifetime == 0 || (!is_existing && m_count == m_subscriptions.size()))
+    {
+        ++m_rejected;
+        return false;
+    }
+
+    // Rates above the source rate get every sample, and so do
+    // measurements without a fixed rate.
+    const uint16_t decimation = source->rate ? std::max((source->rate + message.rate / 2) / message.rate, 1) : 1;
+    const auto expiry_ms = gleos::ms_since_boot() + message.lifetime * 1000u;
+
+    if (is_existing)
+    {
+        // A renewal keeps the spacing of the samples.
+        if (entry->decimation != decimation)
+        {
+            entry->decimation = decimation;
+            entry->phase = 0;
+        }
+
+        entry->expiry_ms = expiry_ms;
+    }
+    else
+    {
+        m_subscriptions[m_count++] = subscription{
+            measurement : message.measurement,
+            destination : message.destination,
+            decimation : decimation,
+            phase : 0,
+            expiry_ms : expiry_ms,
+        };
+    }
+
+    return true;
+}
+
+bool subscription_table::is_subscribed(payload measurement) noexcept
+{
+    expire();
+
+    return std::any_of(m_subscriptions.begin(), m_subscriptions.begin() + m_count, [&](const auto &entry)
+                       { return entry.measurement == measurement; });
+}
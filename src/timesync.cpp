@@ -0,0 +1,124 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/timesync.h"
+#include "gleos/clock.h"
+
+#include "hardware/sync.h"
+
+#include <algorithm>
+
+using namespace gleos;
+using namespace gleos::ice;
+
+/**
+ * Expand a 32-bit receive timestamp to the full local time.
+ */
+static uint64_t local_time(uint32_t timestamp)
+{
+    const auto now = clock::now_us();
+
+    return now - static_cast<uint32_t>(static_cast<uint32_t>(now) - timestamp);
+}
+
+clock_sync::clock_sync(layer3 &layer, network_clock &clock)
+    : m_layer{layer}, m_clock{clock}, m_server{layer.address()}, m_is_server{true}
+{
+    m_clock.set_reference();
+    m_layer.join_group(time_server_group);
+}
+
+clock_sync::clock_sync(layer3 &layer, network_clock &clock, address_type server)
+    : m_layer{layer}, m_clock{clock}, m_server{server}, m_is_server{false}
+{
+}
+
+void clock_sync::request()
+{
+    if (m_is_server)
+    {
+        return;
+    }
+
+    const auto t1 = clock::now_us();
+
+    m_pending = t1;
+
+    m_layer.send(m_server, ice::time_sync{
+        stage : ice::time_sync::request,
+        origin : m_layer.address(),
+        t1 : t1,
+        t2 : 0,
+        t3 : 0,
+    });
+}
+
+void clock_sync::process(const ice::time_sync &message, uint32_t timestamp)
+{
+    if (m_is_server)
+    {
+        if (message.stage != ice::time_sync::request)
+        {
+            return;
+        }
+
+        ice::time_sync response{
+            stage : ice::time_sync::response,
+            origin : message.origin,
+            t1 : message.t1,
+            t2 : m_clock.at(local_time(timestamp)),
+            t3 : 0,
+        };
+
+        // Take the transmit time as late as possible.
+        response.t3 = m_clock.now();
+
+        m_layer.send(message.origin, response);
+        return;
+    }
+
+    if (message.stage != ice::time_sync::response || message.origin != m_layer.address())
+    {
+        return;
+    }
+
+    // Only the response to the last request is of use. Requests
+    // are sent from a timer, so guard the pending request.
+    const auto irq_state = save_and_disable_interrupts();
+    const bool is_pending = m_pending && message.t1 == m_pending;
+    if (is_pending)
+    {
+        m_pending = 0;
+    }
+    restore_interrupts(irq_state);
+
+    if (!is_pending)
+    {
+        return;
+    }
+
+    const auto t4 = local_time(timestamp);
+
+    const auto offset = (static_cast<int64_t>(message.t2 - message.t1) + static_cast<int64_t>(message.t3 - t4)) / 2;
+    const auto delay = static_cast<int64_t>(t4 - message.t1) - static_cast<int64_t>(message.t3 - message.t2);
+
+    // The offset holds halfway the round trip.
+    m_clock.discipline(offset, static_cast<uint32_t>(std::max<int64_t>(delay, 0)), message.t1 + (t4 - message.t1) / 2);
+}
+
+void clock_sync_service::invoke() const
+{
+    m_sync.request();
+}
+
+clock_sync_service::clock_sync_service(uint32_t delay_ms, clock_sync &sync)
+    : timer_interval{delay_ms, nullptr, "ice.timesync", mode::deferred}, m_sync{sync}
+{
+}
@@ -9,9 +9,15 @@
  */
 
 #include "gleos/uart.h"
+#include "gleos/load.h"
+#include "gleos/stats.h"
 
 #include "hardware/irq.h"
 #include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+#include <array>
 
 #define DATA_BITS 8
 #define STOP_BITS 1
@@ -19,8 +25,43 @@
 
 using namespace gleos;
 
+static stats::counter overrun_errors{"uart.overrun"};
+static stats::counter line_errors{"uart.error"};
+static stats::counter dropped_bytes{"uart.dropped"};
+
+// Interrupt driven instance of each UART.
+static std::array<uart *, NUM_UARTS> irq_instances;
+
+static load::task irq_task{"uart.irq"};
+
+/**
+ * Account receive errors latched since the last check.
+ * 
+ * The receive status register is sticky, clear it
+ * once the errors have been counted.
+ */
+static inline void account_errors(uart_inst_t *iface)
+{
+    auto hw = uart_get_hw(iface);
+
+    const uint32_t status = hw->rsr;
+    if (status)
+    {
+        if (status & UART_UARTRSR_OE_BITS)
+        {
+            ++overrun_errors;
+        }
+        if (status & (UART_UARTRSR_FE_BITS | UART_UARTRSR_PE_BITS | UART_UARTRSR_BE_BITS))
+        {
+            ++line_errors;
+        }
+
+        hw->rsr = 0;
+    }
+}
+
 uart::uart(uart_inst_t *iface, int port_tx, int port_rx, int baud_rate)
-    : m_iface{iface}
+    : m_iface{iface}, m_port_rx{port_rx}, m_baud_rate{baud_rate}
 {
     uart::unset(iface);
 
@@ -43,74 +84,272 @@ uart::uart(uart_inst_t *iface, int port_tx, int port_rx, int baud_rate)
 
 uart::~uart()
 {
+    if (is_rx_irq_enabled())
+    {
+        uart_set_irq_enables(m_iface, false, false);
+        irq_set_enabled(uart_get_index(m_iface) ? UART1_IRQ : UART0_IRQ, false);
+        irq_instances[uart_get_index(m_iface)] = nullptr;
+    }
+
     uart::unset(m_iface);
 }
 
+void uart::retime(power::stage stage, uint32_t, void *context)
+{
+    auto device = static_cast<uart *>(context);
+
+    if (stage == power::prepare)
+    {
+        // Let pending output leave the line at the old rate.
+        uart_tx_wait_blocking(device->m_iface);
+    }
+    else
+    {
+        uart_set_baudrate(device->m_iface, device->m_baud_rate);
+    }
+}
+
+void uart::set_baud_rate(int baud_rate)
+{
+    uart_tx_wait_blocking(m_iface);
+
+    m_baud_rate = baud_rate;
+    uart_set_baudrate(m_iface, baud_rate);
+}
+
+void uart::set_half_duplex(int port_de, int port_re)
+{
+    uart_tx_wait_blocking(m_iface);
+
+    m_port_de = port_de;
+    m_port_re = port_re;
+
+    gpio_init(port_de);
+    gpio_put(port_de, false);
+    gpio_set_dir(port_de, GPIO_OUT);
+
+    if (port_re >= 0)
+    {
+        gpio_init(port_re);
+        gpio_put(port_re, false);
+        gpio_set_dir(port_re, GPIO_OUT);
+    }
+
+    // The receiver output floats while the receiver is
+    // disabled. Hold the line idle so no break is seen.
+    gpio_pull_up(m_port_rx);
+}
+
+void uart::drive()
+{
+    if (!is_half_duplex() || m_is_driving)
+    {
+        return;
+    }
+
+    if (m_port_re >= 0)
+    {
+        gpio_put(m_port_re, true);
+    }
+
+    gpio_put(m_port_de, true);
+    m_is_driving = true;
+}
+
+void uart::release()
+{
+    if (!m_is_driving)
+    {
+        return;
+    }
+
+    auto hw = uart_get_hw(m_iface);
+
+    // Wait until the last character has moved into the
+    // shift register, this may take the whole FIFO.
+    while (!(hw->fr & UART_UARTFR_TXFE_BITS))
+    {
+        tight_loop_contents();
+    }
+
+    // The busy flag clears when the stop bit has been sent. Do not
+    // let an interrupt run in between, that would hold the bus.
+    const auto irq_state = save_and_disable_interrupts();
+
+    while (hw->fr & UART_UARTFR_BUSY_BITS)
+    {
+        tight_loop_contents();
+    }
+
+    gpio_put(m_port_de, false);
+
+    if (m_port_re >= 0)
+    {
+        gpio_put(m_port_re, false);
+    }
+
+    restore_interrupts(irq_state);
+
+    m_is_driving = false;
+}
+
 void uart::unset(uart_inst_t *iface)
 {
     uart_deinit(iface);
 }
 
-// #define ENABLE_IRQ 1
+void uart::irq_handler()
+{
+    load::scope scope{irq_task};
 
-#if ENABLE_IRQ
-static uart *m_static_weak_ref{nullptr};
-#endif // ENABLE_IRQ
+    for (auto device : irq_instances)
+    {
+        if (device)
+        {
+            device->receive_irq();
+        }
+    }
+}
 
-void uart::irq_handler()
+void uart::receive_irq()
 {
-#if ENABLE_IRQ
-    std::array<uint8_t, 1024> buffer;
-    size_t buffer_len = 0;
+    bool is_received = false;
 
-    while (uart_is_readable(m_static_weak_ref->m_iface))
+    // The receive timeout fires once the line has been idle for 32 bit
+    // periods. The last byte of a burst arrived that much earlier.
+    auto timestamp = time_us_32();
+    if (uart_get_hw(m_iface)->mis & UART_UARTMIS_RTMIS_BITS)
     {
-        buffer[buffer_len++] = uart_getc(m_static_weak_ref->m_iface);
+        timestamp -= 32 * 1000000 / m_baud_rate;
     }
 
-    m_static_weak_ref->m_on_byte_routine(buffer.data(), buffer_len);
-#endif // ENABLE_IRQ
+    while (uart_is_readable(m_iface))
+    {
+        const uint8_t c = uart_get_hw(m_iface)->dr;
+
+        const auto head_next = (m_rx_head + 1) % sizeof(m_rx_buffer);
+        if (head_next == m_rx_tail)
+        {
+            ++dropped_bytes;
+            continue;
+        }
+
+        m_rx_buffer[m_rx_head] = c;
+        m_rx_time[m_rx_head] = timestamp;
+        m_rx_head = head_next;
+        is_received = true;
+    }
+
+    account_errors(m_iface);
+
+    if (is_received)
+    {
+        event::post(m_rx_event);
+    }
 }
 
-void uart::enable_irq()
+void uart::enable_rx_irq(uint32_t event)
 {
-#if ENABLE_IRQ
-    // int UART_IRQ = UART_ID == m_iface ? UART0_IRQ : UART1_IRQ;
-    // int UART_IRQ = UART0_IRQ;
-    int UART_IRQ = UART0_IR1;
+    const auto irq = uart_get_index(m_iface) ? UART1_IRQ : UART0_IRQ;
 
-    irq_clear(UART_IRQ);
-    irq_set_exclusive_handler(UART_IRQ, uart::irq_handler);
-    irq_set_enabled(UART_IRQ, true);
+    m_rx_event = event;
+    irq_instances[uart_get_index(m_iface)] = this;
+
+    irq_set_exclusive_handler(irq, uart::irq_handler);
+    irq_set_enabled(irq, true);
 
     // Now enable the UART to send interrupts - RX only
     uart_set_irq_enables(m_iface, true, false);
+}
 
-    m_static_weak_ref = this;
-#endif // ENABLE_IRQ
+void uart::wait_rx(uint32_t events)
+{
+    if (is_rx_irq_enabled())
+    {
+        event::wait(m_rx_event | events);
+    }
+    else
+    {
+        tight_loop_contents();
+    }
 }
 
 uint8_t uart::read_byte()
 {
-    return uart_getc(m_iface);
+    if (is_rx_irq_enabled())
+    {
+        while (!rx_has_data())
+        {
+            wait_rx();
+        }
+
+        const auto c = m_rx_buffer[m_rx_tail];
+        m_rx_timestamp = m_rx_time[m_rx_tail];
+        m_rx_tail = (m_rx_tail + 1) % sizeof(m_rx_buffer);
+
+        return c;
+    }
+
+    auto c = uart_getc(m_iface);
+
+    m_rx_timestamp = time_us_32();
+
+    account_errors(m_iface);
+
+    return c;
 }
 
 void uart::read(uint8_t *buffer, size_t len)
 {
+    if (is_rx_irq_enabled())
+    {
+        while (len--)
+        {
+            *buffer++ = read_byte();
+        }
+
+        return;
+    }
+
     uart_read_blocking(m_iface, buffer, len);
+
+    m_rx_timestamp = time_us_32();
+
+    account_errors(m_iface);
 }
 
 void uart::write_putc(char c)
 {
+    drive();
+
     uart_putc(m_iface, c);
+
+    if (!m_is_holding)
+    {
+        release();
+    }
 }
 
 void uart::write(const uint8_t *buffer, size_t len)
 {
+    drive();
+
     uart_write_blocking(m_iface, buffer, len);
+
+    if (!m_is_holding)
+    {
+        release();
+    }
 }
 
-void uart::operator<<(const std::string &str)
+void uart::begin_transmission()
 {
-    uart_puts(m_iface, str.c_str());
+    m_is_holding = true;
+}
+
+void uart::end_transmission()
+{
+    m_is_holding = false;
+
+    release();
 }
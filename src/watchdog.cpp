@@ -9,11 +9,31 @@
  */
 
 #include "gleos/watchdog.h"
+#include "gleos/load.h"
 
+#include "hardware/sync.h"
+#include "hardware/timer.h"
 #include "hardware/watchdog.h"
+#include "pico/time.h"
+
+#include <array>
+#include <cstring>
+#include <iostream>
+
+/* Marks a valid fault record in the scratch registers. */
+#define FAULT_MAGIC 0x474c5744
 
 using namespace gleos;
 
+// NOTE: The registry is zero initialized before any constructor runs. This
+//       allows heartbeats with static storage in any translation unit to
+//       register themselves.
+static std::array<watchdog::heartbeat *, GLEOS_WATCHDOG_REGISTRY_SIZE> registry;
+static size_t registry_size;
+
+static struct repeating_timer supervisor_timer;
+static load::task supervisor_task{"watchdog"};
+
 void watchdog::start(uint32_t delay_ms)
 {
     watchdog_enable(delay_ms, 1);
@@ -33,3 +53,129 @@ void watchdog::reboot()
 {
     watchdog_reboot(0, SRAM_END, 0);
 }
+
+watchdog::heartbeat::heartbeat(const char *name, uint32_t timeout_ms)
+    : m_name{name},
+      m_id{gleos::crc16(reinterpret_cast<const uint8_t *>(name), std::strlen(name))},
+      m_timeout_us{timeout_ms * 1000},
+      m_last{time_us_32()}
+{
+    const auto irq_state = save_and_disable_interrupts();
+
+    // NOTE: A heartbeat which does not fit the registry
+    //       is not supervised.
+    if (registry_size < registry.size())
+    {
+        registry[registry_size++] = this;
+    }
+
+    restore_interrupts(irq_state);
+}
+
+watchdog::heartbeat::~heartbeat()
+{
+    const auto irq_state = save_and_disable_interrupts();
+
+    for (size_t i = 0; i < registry_size; ++i)
+    {
+        if (registry[i] == this)
+        {
+            // Keep the registration order intact.
+            std::memmove(&registry[i], &registry[i + 1], (registry_size - i - 1) * sizeof(registry[0]));
+            --registry_size;
+            break;
+        }
+    }
+
+    restore_interrupts(irq_state);
+}
+
+void watchdog::heartbeat::beat() noexcept
+{
+    m_last = time_us_32();
+}
+
+bool watchdog::heartbeat::is_healthy() const noexcept
+{
+    return time_us_32() - m_last <= m_timeout_us;
+}
+
+/**
+ * Feed the watchdog if all heartbeats are healthy.
+ */
+static bool supervisor_callback(struct repeating_timer *)
+{
+    load::scope scope{supervisor_task};
+
+    for (size_t i = 0; i < registry_size; ++i)
+    {
+        if (!registry[i]->is_healthy())
+        {
+            // Record the fault and stop the supervisor. The watchdog
+            // will expire and reboot the system.
+            watchdog_hw->scratch[0] = FAULT_MAGIC;
+            watchdog_hw->scratch[1] = registry[i]->id();
+            watchdog_hw->scratch[2] = ms_since_boot();
+            watchdog_hw->scratch[3] = ~(FAULT_MAGIC ^ watchdog_hw->scratch[1] ^ watchdog_hw->scratch[2]);
+
+            return false;
+        }
+    }
+
+    watchdog_update();
+
+    return true;
+}
+
+void watchdog::supervise(uint32_t delay_ms)
+{
+    // All heartbeats are registered by now, so the
+    // task of the previous fault can be named.
+    fault fault;
+    if (last_fault(fault))
+    {
+        const auto heartbeat = find(fault.id);
+
+        std::cout << "Watchdog reboot" << '\n'
+                  << " Task: " << (heartbeat ? heartbeat->name() : "unknown") << '\n'
+                  << " Uptime: " << fault.uptime_ms << "ms" << std::endl;
+    }
+
+    watchdog_enable(delay_ms, 1);
+
+    // Check several times per watchdog period so a healthy
+    // system is never close to the deadline.
+    add_repeating_timer_ms(delay_ms / 4, supervisor_callback, nullptr, &supervisor_timer);
+}
+
+bool watchdog::last_fault(fault &fault)
+{
+    if (!watchdog_caused_reboot() || watchdog_hw->scratch[0] != FAULT_MAGIC)
+    {
+        return false;
+    }
+
+    const bool is_valid = watchdog_hw->scratch[3] == ~(FAULT_MAGIC ^ watchdog_hw->scratch[1] ^ watchdog_hw->scratch[2]);
+    if (is_valid)
+    {
+        fault.id = watchdog_hw->scratch[1];
+        fault.uptime_ms = watchdog_hw->scratch[2];
+    }
+
+    watchdog_hw->scratch[0] = 0;
+
+    return is_valid;
+}
+
+const watchdog::heartbeat *watchdog::find(uint16_t id) noexcept
+{
+    for (size_t i = 0; i < registry_size; ++i)
+    {
+        if (registry[i]->id() == id)
+        {
+            return registry[i];
+        }
+    }
+
+    return nullptr;
+}
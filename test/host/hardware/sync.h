@@ -0,0 +1,24 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+// Host replacement of the SDK interrupt masking.
+
+#pragma once
+
+#include <cstdint>
+
+inline uint32_t save_and_disable_interrupts()
+{
+    return 0;
+}
+
+inline void restore_interrupts(uint32_t)
+{
+}
@@ -0,0 +1,16 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+// Host replacement of the SDK synchronisation primitives.
+// Tests run on a single thread without interrupts.
+
+#pragma once
+
+#include "hardware/sync.h"
@@ -0,0 +1,33 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+// Host replacement of the SDK time functions. The
+// time only moves when a test moves the timer.
+
+#pragma once
+
+#include "hardware/structs/timer.h"
+
+#include <cstdint>
+
+typedef uint64_t absolute_time_t;
+
+uint32_t time_us_32();
+uint64_t time_us_64();
+
+inline absolute_time_t from_us_since_boot(uint64_t us)
+{
+    return us;
+}
+
+inline uint64_t to_us_since_boot(absolute_time_t time)
+{
+    return time;
+}
@@ -0,0 +1,45 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "gleos/gleos.h"
+
+#include "pico/time.h"
+
+static timer_hw_t timer_storage;
+
+timer_hw_t *timer_hw = &timer_storage;
+
+uint64_t time_us_64()
+{
+    return (static_cast<uint64_t>(timer_hw->timerawh) << 32) | timer_hw->timerawl;
+}
+
+uint32_t time_us_32()
+{
+    return timer_hw->timerawl;
+}
+
+namespace gleos
+{
+    // Same as the firmware, the registries identify entries by this CRC.
+    uint16_t crc16(const uint8_t *data, size_t length, uint16_t crc)
+    {
+        uint8_t tmp = 0;
+
+        while (length--)
+        {
+            tmp = crc >> 8 ^ *data++;
+            tmp ^= tmp >> 4;
+            crc = (crc << 8) ^ ((uint16_t)(tmp << 12)) ^ ((uint16_t)(tmp << 5)) ^ ((uint16_t)tmp);
+        }
+
+        return crc;
+    }
+}
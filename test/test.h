@@ -0,0 +1,41 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#pragma once
+
+#include <cstdio>
+
+namespace gleos::test
+{
+    inline int failures = 0;
+
+    /**
+     * Check a condition, report it if it does not hold.
+     * 
+     * The test continues, so a run shows all failed checks at once.
+     */
+    inline void check(bool condition, const char *what)
+    {
+        if (!condition)
+        {
+            std::printf("FAIL: %s\n", what);
+            ++failures;
+        }
+    }
+
+    /**
+     * Test result as the process exit code.
+     */
+    inline int result()
+    {
+        std::printf("%s\n", failures ? "FAILED" : "OK");
+        return failures ? 1 : 0;
+    }
+} // gleos::test
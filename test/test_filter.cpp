@@ -0,0 +1,97 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "test.h"
+
+#include "gleos/filter.h"
+
+#include <cmath>
+
+using namespace gleos;
+using namespace gleos::test;
+
+// The acceleration filter of fw_imu, 1 kHz in and 100 Hz out.
+constexpr double sample_rate = 1000;
+constexpr double output_rate = 100;
+constexpr double cutoff = 40;
+
+constexpr auto taps = filter::cic_compensator<41, 6, 5>(cutoff, output_rate - cutoff, sample_rate / 5, 66);
+
+using filter_type = filter::chain<filter::cic_decimator<6, 5>, filter::fir_decimator<41, 2>>;
+
+/**
+ * Gain of the fixed-point filter for a sine, in dB.
+ */
+static double gain(double frequency)
+{
+    constexpr double amplitude = 20000;
+
+    filter_type filter{{}, {taps}};
+
+    double power = 0;
+    int count = 0;
+
+    for (int n = 0; n < 40000; ++n)
+    {
+        const auto in = static_cast<int16_t>(std::lround(amplitude * std::sin(2 * M_PI * frequency * n / sample_rate)));
+
+        int16_t out;
+        if (filter.process(in, out) && n > 2000)
+        {
+            power += static_cast<double>(out) * out;
+            ++count;
+        }
+    }
+
+    return 10 * std::log10(power / count / (amplitude * amplitude / 2) + 1e-30);
+}
+
+int main()
+{
+    // The CIC droop is taken out up to the cutoff.
+    double passband_min = 0;
+    double passband_max = 0;
+
+    for (double frequency = 1; frequency <= cutoff; frequency += 3)
+    {
+        const auto value = gain(frequency);
+        passband_min = std::min(passband_min, value);
+        passband_max = std::max(passband_max, value);
+    }
+
+    std::printf("passband %.3f to %.3f dB\n", passband_min, passband_max);
+    check(passband_min >= -0.1 && passband_max <= 0.1, "passband is flat within 0.1 dB");
+
+    // Anything which lands in the passband after decimation to the
+    // output rate, whether it folds at the CIC or at the FIR stage.
+    double alias_max = -200;
+    double alias_frequency = 0;
+
+    for (double frequency = output_rate - cutoff; frequency <= sample_rate / 2; frequency += 5)
+    {
+        const auto folded = std::fmod(frequency, output_rate);
+        if (folded > cutoff && folded < output_rate - cutoff)
+        {
+            continue;
+        }
+
+        const auto value = gain(frequency);
+        if (value > alias_max)
+        {
+            alias_max = value;
+            alias_frequency = frequency;
+        }
+    }
+
+    std::printf("aliases at most %.1f dB, at %.0f Hz\n", alias_max, alias_frequency);
+    check(alias_max <= -65, "aliases are down by 65 dB");
+
+    return result();
+}
@@ -0,0 +1,78 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "test.h"
+
+#include "gleos/fixed.h"
+
+#include <cmath>
+
+using namespace gleos;
+using namespace gleos::test;
+
+/**
+ * Largest error of `scale` over all 16-bit inputs, in output LSB.
+ * 
+ * @param factor    Fixed-point factor.
+ * @param exact     The factor it was made from.
+ */
+template <int F, typename T>
+static double error_max(fixed<F, T> factor, double exact)
+{
+    double value = 0;
+
+    for (int32_t in = INT16_MIN; in <= INT16_MAX; ++in)
+    {
+        const auto out = scale<int16_t>(static_cast<int16_t>(in), factor);
+        value = std::max(value, std::fabs(out - in * exact));
+    }
+
+    return value;
+}
+
+template <int F, typename T>
+static void check_factor(const char *name, fixed<F, T> factor, double exact)
+{
+    const auto value = error_max(factor, exact);
+
+    std::printf("%-16s error at most %.6f LSB\n", name, value);
+
+    // Ties round either way, allow for the rounding of the reference.
+    check(value <= 0.5 + 1e-9, name);
+}
+
+int main()
+{
+    // The factors of the drivers, as they are set up there.
+
+    // ICM-20600 accelerometer in mg for the 2 to 16 g ranges.
+    check_factor("icm20600 2g", q15::from(2000.0 / 32768), 2000.0 / 32768);
+    check_factor("icm20600 4g", q15::from(4000.0 / 32768), 4000.0 / 32768);
+    check_factor("icm20600 8g", q15::from(8000.0 / 32768), 8000.0 / 32768);
+    check_factor("icm20600 16g", q15::from(16000.0 / 32768), 16000.0 / 32768);
+
+    // ICM-20600 gyroscope in dps for the 250 to 2000 dps ranges.
+    check_factor("icm20600 250dps", q15::from(250.0 / 32768), 250.0 / 32768);
+    check_factor("icm20600 500dps", q15::from(500.0 / 32768), 500.0 / 32768);
+    check_factor("icm20600 1000dps", q15::from(1000.0 / 32768), 1000.0 / 32768);
+    check_factor("icm20600 2000dps", q15::from(2000.0 / 32768), 2000.0 / 32768);
+
+    // ICM-20600 temperature in degrees Celsius.
+    check_factor("icm20600 temp", fixed<23, int16_t>::from(1 / 326.8), 1 / 326.8);
+
+    // AK09918 magnetometer in uT.
+    check_factor("ak09918", fixed<17, int16_t>::from(0.15), 0.15);
+
+    // Saturation at the edges of the output range.
+    check(scale<int16_t>(int16_t{INT16_MAX}, q16::from(2.0)) == INT16_MAX, "saturates up");
+    check(scale<int16_t>(int16_t{INT16_MIN}, q16::from(2.0)) == INT16_MIN, "saturates down");
+
+    return result();
+}
@@ -0,0 +1,156 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "test.h"
+
+#include "gleos/netclock.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <initializer_list>
+
+using namespace gleos;
+using namespace gleos::test;
+
+/**
+ * Local clock which runs off the network time by a fixed rate.
+ */
+struct drifting_clock
+{
+    double drift;
+    double start;
+
+    /**
+     * Local time at network time.
+     */
+    uint64_t at(double network) const
+    {
+        return static_cast<uint64_t>(std::llround(start + network * (1.0 + drift)));
+    }
+};
+
+/**
+ * Two-way exchange as done by `clock_sync`, the server is the reference.
+ */
+struct exchange
+{
+    int64_t offset;
+    uint32_t delay;
+    uint64_t local;
+};
+
+static exchange measure(const drifting_clock &local, double network, double forward, double backward)
+{
+    const auto t1 = local.at(network);
+    const auto t2 = static_cast<uint64_t>(std::llround(network + forward));
+    const auto t3 = t2 + 50;
+    const auto t4 = local.at(static_cast<double>(t3) + backward);
+
+    return exchange{
+        offset : (static_cast<int64_t>(t2 - t1) + static_cast<int64_t>(t3 - t4)) / 2,
+        delay : static_cast<uint32_t>(static_cast<int64_t>(t4 - t1) - static_cast<int64_t>(t3 - t2)),
+        local : t1 + (t4 - t1) / 2,
+    };
+}
+
+/**
+ * Clock behaviour over the last minute of a run.
+ */
+struct outcome
+{
+    /* Largest error against the network time shifted by the delay asymmetry. */
+    double error_max;
+    /* Mean rate correction in parts per billion. */
+    double rate_mean;
+};
+
+/**
+ * Run the clock against one second exchanges.
+ */
+static outcome run(ice::network_clock &clock, const drifting_clock &local, double forward, double backward, int seconds)
+{
+    const double bias = (forward - backward) / 2;
+    outcome outcome{};
+
+    std::srand(1);
+
+    for (int second = 1; second <= seconds; ++second)
+    {
+        const double network = second * 1000000.0;
+
+        // Up to 10us jitter on each leg.
+        const double jitter_forward = std::rand() % 21 - 10;
+        const double jitter_backward = std::rand() % 21 - 10;
+
+        const auto sample = measure(local, network, forward + jitter_forward, backward + jitter_backward);
+        clock.discipline(sample.offset, sample.delay, sample.local);
+
+        // Sample the clock halfway the interval as well, the rate
+        // correction carries it between measurements.
+        if (second > seconds - 60)
+        {
+            for (const double at : {network, network + 500000.0})
+            {
+                const double error = static_cast<double>(clock.at(local.at(at))) - at - bias;
+                outcome.error_max = std::max(outcome.error_max, std::fabs(error));
+            }
+
+            outcome.rate_mean += clock.rate() / 60.0;
+        }
+    }
+
+    return outcome;
+}
+
+int main()
+{
+    // A fast crystal and an asymmetric link. The asymmetry shows as a
+    // fixed offset of half the difference, which no two-way exchange
+    // can tell apart from a clock offset.
+    {
+        ice::network_clock clock;
+        const drifting_clock local{drift : 80e-6, start : 123456789.0};
+
+        const auto outcome = run(clock, local, 300, 100, 600);
+
+        std::printf("fast clock: error %.1f us, rate %.0f ppb\n", outcome.error_max, outcome.rate_mean);
+        check(clock.is_synchronized(), "fast clock synchronizes");
+        check(outcome.error_max <= 20, "fast clock follows network time within 20us");
+        check(std::fabs(outcome.rate_mean + 79994) <= 500, "fast clock rate converges to the drift");
+    }
+
+    // A slow crystal with the asymmetry the other way around.
+    {
+        ice::network_clock clock;
+        const drifting_clock local{drift : -150e-6, start : 5000.0};
+
+        const auto outcome = run(clock, local, 80, 400, 600);
+
+        std::printf("slow clock: error %.1f us, rate %.0f ppb\n", outcome.error_max, outcome.rate_mean);
+        check(outcome.error_max <= 20, "slow clock follows network time within 20us");
+        check(std::fabs(outcome.rate_mean - 150023) <= 500, "slow clock rate converges to the drift");
+    }
+
+    // A delayed response skews the offset and is rejected.
+    {
+        ice::network_clock clock;
+        const drifting_clock local{drift : 20e-6, start : 0.0};
+
+        run(clock, local, 200, 200, 120);
+
+        const auto before = clock.at(local.at(121e6));
+        const auto sample = measure(local, 121e6, 200, 5200);
+
+        check(!clock.discipline(sample.offset, sample.delay, sample.local), "delayed response is rejected");
+        check(clock.at(local.at(121e6)) == before, "rejected response leaves the clock");
+    }
+
+    return result();
+}
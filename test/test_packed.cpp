@@ -0,0 +1,175 @@
+/**
+ * Glonax Embedded Operating System.
+ *
+ * Copyright (C) 2021 Laixer Equipment B.V.
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the included license.  See the LICENSE file for details.
+ */
+
+#include "test.h"
+
+#include "gleos/packed.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+using namespace gleos;
+using namespace gleos::test;
+
+using sample = std::array<int16_t, 3>;
+
+// As fw_imu: an extended payload of 64 bytes, at most half a second at 100 Hz.
+constexpr size_t payload_size = 64;
+constexpr size_t samples_max = 50;
+
+// The plain acceleration block carries this many samples per payload.
+constexpr size_t block_capacity = (payload_size - 1) / sizeof(sample);
+
+/**
+ * Uniform noise from a fixed sequence, the same on every host.
+ */
+struct noise
+{
+    uint32_t state{1};
+
+    int16_t operator()(int amplitude)
+    {
+        state = state * 1664525 + 1013904223;
+        return amplitude ? static_cast<int16_t>(static_cast<int>(state >> 8) % (2 * amplitude + 1) - amplitude) : 0;
+    }
+};
+
+/**
+ * Encode samples into payloads and decode them again.
+ * 
+ * @return Number of payloads, or zero if a payload did not decode to its input.
+ */
+static size_t round_trip(const std::vector<sample> &samples)
+{
+    packed::encoder<samples_max> encoder{payload_size};
+    std::vector<sample> decoded;
+    size_t payloads = 0;
+    bool is_valid = true;
+
+    const auto flush = [&]
+    {
+        uint8_t payload[payload_size];
+        const auto size = encoder.encode(payload);
+
+        is_valid &= size <= payload_size && size == packed::encoded_size(payload);
+        is_valid &= packed::decode(payload, size, [&](int16_t x, int16_t y, int16_t z)
+                                   { decoded.push_back({x, y, z}); }) == encoder.count();
+
+        // A truncated payload is malformed.
+        is_valid &= size == packed::header_size || packed::decode(payload, size - 1, [](int16_t, int16_t, int16_t) {}) == 0;
+
+        encoder.reset();
+        ++payloads;
+    };
+
+    for (const auto &value : samples)
+    {
+        if (!encoder.add(value[0], value[1], value[2]))
+        {
+            flush();
+            is_valid &= encoder.add(value[0], value[1], value[2]);
+        }
+    }
+
+    flush();
+
+    return is_valid && decoded == samples ? payloads : 0;
+}
+
+/**
+ * Slow motion around 1 g on z with noise on top.
+ */
+static std::vector<sample> motion(int amplitude)
+{
+    noise noise;
+    std::vector<sample> samples;
+
+    for (int n = 0; n < 5000; ++n)
+    {
+        const auto t = n / 100.0;
+        samples.push_back({
+            static_cast<int16_t>(std::lround(200 * std::sin(2 * M_PI * 0.2 * t)) + noise(amplitude)),
+            static_cast<int16_t>(std::lround(100 * std::cos(2 * M_PI * 0.1 * t)) + noise(amplitude)),
+            static_cast<int16_t>(1000 + noise(amplitude)),
+        });
+    }
+
+    return samples;
+}
+
+int main()
+{
+    // A single sample is a header only.
+    {
+        packed::encoder<samples_max> encoder{payload_size};
+        encoder.add(-32768, 0, 32767);
+
+        uint8_t payload[payload_size];
+        const auto size = encoder.encode(payload);
+
+        sample decoded{};
+        const auto count = packed::decode(payload, size, [&](int16_t x, int16_t y, int16_t z)
+                                          { decoded = {x, y, z}; });
+
+        check(size == packed::header_size, "single sample takes the header only");
+        check(count == 1 && decoded == sample{-32768, 0, 32767}, "single sample round-trips");
+    }
+
+    // Deltas across the full range take the widest field.
+    {
+        std::vector<sample> samples;
+        for (int n = 0; n < 200; ++n)
+        {
+            samples.push_back({static_cast<int16_t>(n % 2 ? -32768 : 0), static_cast<int16_t>(n % 2 ? 32767 : -32768), static_cast<int16_t>(n)});
+        }
+
+        packed::encoder<samples_max> encoder{payload_size};
+        encoder.add(0, -32768, 0);
+        encoder.add(-32768, 32767, 1);
+
+        uint8_t payload[payload_size];
+        encoder.encode(payload);
+
+        const uint16_t widths = payload[1] | payload[2] << 8;
+        check((widths & 0x1f) == packed::width_max, "full range delta takes 16 bits");
+        check(round_trip(samples) > 0, "full range deltas round-trip");
+    }
+
+    // Worst case noise still round-trips, at about the block capacity.
+    {
+        noise noise;
+        std::vector<sample> samples;
+        for (int n = 0; n < 5000; ++n)
+        {
+            samples.push_back({noise(32767), noise(32767), noise(32767)});
+        }
+
+        const auto payloads = round_trip(samples);
+        check(payloads > 0, "full range noise round-trips");
+    }
+
+    // Compression against the plain acceleration block.
+    for (const auto amplitude : {0, 1, 5, 40})
+    {
+        const auto samples = motion(amplitude);
+        const auto payloads = round_trip(samples);
+
+        check(payloads > 0, "motion round-trips");
+
+        const auto per_payload = static_cast<double>(samples.size()) / std::max<size_t>(payloads, 1);
+        std::printf("noise +-%2d LSB: %.1f samples per payload, %.1fx the block\n", amplitude, per_payload, per_payload / block_capacity);
+
+        check(per_payload >= block_capacity, "packing never loses against the block");
+    }
+
+    return result();
+}